@@ -0,0 +1,963 @@
+/*
+  ==============================================================================
+
+    Bench.cpp
+    Created: 21 Oct 2026 10:14:32am
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+/*
+ Headless renderer for the golden-output regression test and the benchmarks.
+ Every mode creates the processor the way a host does and plays it a fixed
+ MIDI script. No audio device or editor is involved.
+
+   JX11Bench golden <file> [--update] [--max-slowdown <ratio>]
+       Renders every program at several sample rates and block sizes and
+       compares the level and spectrum with the references in <file>.
+       --update writes the references instead. With --max-slowdown, the
+       run also fails when rendering all programs takes more than <ratio>
+       times as long as stored with the references. Both times are
+       measured against a fixed calibration loop, so the references still
+       apply on a faster or slower machine.
+   JX11Bench load
+       Block load histogram of every program, see LoadStats.
+   JX11Bench profile
+       CPU cycles per DSP stage (timer ticks on ARM), needs the
+       JX11_PROFILING option.
+   JX11Bench rtcheck
+       Allocations and locks on the audio thread while rendering, switching
+       programs from MIDI, rendering offline and under MIDI stress. Needs
+       the JX11_RT_CHECKS option, and a release build because DBG()
+       allocates.
+   JX11Bench state [instances]
+       Time to load a session into each instance, binary and XML state.
+       Fails if a loaded instance differs from the saved one.
+   JX11Bench startup [instances]
+       Time and memory to create each instance.
+   JX11Bench polyphony
+       Sends more notes to each part than its polyphony. Fails if a part
+       ends up playing more voices than it may, or fewer.
+   JX11Bench voices
+       Render time with all voices playing, without and with unison, and
+       L1 data cache misses where the performance counters can be read
+       (Linux only).
+ */
+
+#include "PluginProcessor.h"
+#include "Profiler.h"
+#include "RealtimeChecks.h"
+
+#include <juce_dsp/juce_dsp.h>
+
+#if JUCE_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#endif
+
+namespace
+{
+struct ScriptEvent
+{
+    double time; // seconds
+    uint8_t data0;
+    uint8_t data1;
+    uint8_t data2;
+};
+
+using Script = std::vector<ScriptEvent>;
+
+// Plays a bass note, a legato note (glide in the mono programs) and a chord,
+// with the mod wheel, pitch bend and pressure moving, then lets everything
+// release. Long enough for the slowest release tails to become quiet.
+const Script goldenScript = {
+    {0.00, 0x90, 48, 100}, {0.10, 0x90, 55, 64},  {0.20, 0x90, 60, 127}, {0.30, 0xB0, 1, 32},
+    {0.35, 0xB0, 1, 64},   {0.40, 0xE0, 0, 80},   {0.40, 0xB0, 1, 96},   {0.45, 0xD0, 80, 0},
+    {0.45, 0xB0, 1, 127},  {0.50, 0x80, 55, 0},   {0.60, 0x90, 64, 90},  {0.60, 0x90, 67, 90},
+    {0.80, 0xE0, 0, 64},   {0.90, 0xD0, 0, 0},    {0.90, 0xB0, 1, 0},    {1.00, 0x80, 48, 0},
+    {1.00, 0x80, 60, 0},   {1.00, 0x80, 64, 0},   {1.00, 0x80, 67, 0},
+};
+
+const double goldenLength = 1.6;
+const double goldenRates[] = {44100.0, 48000.0, 96000.0};
+
+// The first block size renders the reference, the others must match it
+const int goldenBlockSizes[] = {512, 64};
+
+// Differences allowed between a render and its reference, in dB
+const float levelTolerance = 0.5f;
+const float spectrumTolerance = 1.0f;
+
+struct RenderSettings
+{
+    double sampleRate = 48000.0;
+    int blockSize = 512;
+    bool offline = false;
+};
+
+int messageSize(uint8_t data0)
+{
+    // Program change and channel pressure have a single data byte
+    int type = data0 & 0xF0;
+    return (type == 0xC0 || type == 0xD0) ? 2 : 3;
+}
+
+// Plays the script from the start for the given number of seconds and
+// returns the stereo output
+juce::AudioBuffer<float> render(JX11AudioProcessor &processor, const RenderSettings &settings,
+                                const Script &script, double seconds)
+{
+    processor.setNonRealtime(settings.offline);
+    processor.setRateAndBufferSizeDetails(settings.sampleRate, settings.blockSize);
+    processor.prepareToPlay(settings.sampleRate, settings.blockSize);
+
+    const int numChannels = processor.getTotalNumOutputChannels();
+    const int totalSamples = int(seconds * settings.sampleRate);
+
+    juce::AudioBuffer<float> output(2, totalSamples);
+    juce::AudioBuffer<float> block(numChannels, settings.blockSize);
+    juce::MidiBuffer midi;
+
+    size_t next = 0;
+    for (int start = 0; start < totalSamples; start += settings.blockSize)
+    {
+        const int numSamples = std::min(settings.blockSize, totalSamples - start);
+
+        midi.clear();
+        while (next < script.size())
+        {
+            const ScriptEvent &event = script[next];
+            int position = int(event.time * settings.sampleRate);
+            if (position >= start + numSamples)
+                break;
+
+            const uint8_t data[3] = {event.data0, event.data1, event.data2};
+            midi.addEvent(data, messageSize(event.data0), position - start);
+            ++next;
+        }
+
+        // The last block may be shorter, as it can be in a host
+        juce::AudioBuffer<float> view(block.getArrayOfWritePointers(), numChannels, numSamples);
+        view.clear();
+        processor.processBlock(view, midi);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            output.copyFrom(ch, start, view, std::min(ch, numChannels - 1), 0, numSamples);
+        }
+    }
+    return output;
+}
+
+double millisecondsSince(double start) { return juce::Time::getMillisecondCounterHiRes() - start; }
+
+// Fixed floating-point work that doesn't depend on the plugin, the golden
+// test stores its render times as multiples of it. Best of several runs,
+// the slower ones were interrupted.
+double calibrationMilliseconds()
+{
+    double best = std::numeric_limits<double>::max();
+    for (int run = 0; run < 5; ++run)
+    {
+        double start = juce::Time::getMillisecondCounterHiRes();
+
+        float phase = 0.0f;
+        float state = 0.0f;
+        for (int i = 0; i < 1000000; ++i)
+        {
+            phase += 0.0123f;
+            phase -= (phase >= 1.0f) ? 1.0f : 0.0f;
+            state += 0.01f * (std::sin(juce::MathConstants<float>::twoPi * phase) - state);
+        }
+        volatile float sink = state;
+        juce::ignoreUnused(sink);
+
+        best = std::min(best, millisecondsSince(start));
+    }
+    return best;
+}
+
+//==============================================================================
+/*
+ Level and spectrum of a render in short windows. A fingerprint is small
+ enough to keep the references of every program in the repository, and it
+ ignores differences in phase that are inaudible, such as the rounding of a
+ different compiler.
+ */
+struct Fingerprint
+{
+    // Everything below 250 Hz, then octaves up to 16 kHz
+    static constexpr int NUM_BANDS = 7;
+
+    struct Window
+    {
+        float left; // dB
+        float right;
+        std::array<float, NUM_BANDS> bands;
+    };
+
+    std::vector<Window> windows;
+};
+
+float powerToDecibels(double power)
+{
+    return float(std::max(10.0 * std::log10(power + 1.0e-15), -120.0));
+}
+
+// About 90 ms at every sample rate
+int fftOrderFor(double sampleRate) { return (sampleRate > 50000.0) ? 13 : 12; }
+
+Fingerprint fingerprint(const juce::AudioBuffer<float> &audio, double sampleRate)
+{
+    const int order = fftOrderFor(sampleRate);
+    const int size = 1 << order;
+
+    juce::dsp::FFT fft(order);
+    std::vector<float> data(size_t(2 * size));
+
+    Fingerprint result;
+    const float *left = audio.getReadPointer(0);
+    const float *right = audio.getReadPointer(1);
+
+    for (int start = 0; start + size <= audio.getNumSamples(); start += size)
+    {
+        Fingerprint::Window window;
+
+        double sumLeft = 0.0;
+        double sumRight = 0.0;
+        std::fill(data.begin(), data.end(), 0.0f);
+
+        for (int i = 0; i < size; ++i)
+        {
+            float l = left[start + i];
+            float r = right[start + i];
+            sumLeft += double(l * l);
+            sumRight += double(r * r);
+
+            float hann = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * float(i) /
+                                                float(size));
+            data[size_t(i)] = 0.5f * (l + r) * hann;
+        }
+        window.left = powerToDecibels(sumLeft / double(size));
+        window.right = powerToDecibels(sumRight / double(size));
+
+        fft.performFrequencyOnlyForwardTransform(data.data());
+
+        std::array<double, Fingerprint::NUM_BANDS> power{};
+        for (int bin = 1; bin < size / 2; ++bin)
+        {
+            double hz = double(bin) * sampleRate / double(size);
+            int band = (hz < 250.0) ? 0 : 1 + int(std::log2(hz / 250.0));
+            if (band < Fingerprint::NUM_BANDS)
+            {
+                double magnitude = double(data[size_t(bin)]) / double(size);
+                power[size_t(band)] += magnitude * magnitude;
+            }
+        }
+
+        for (int b = 0; b < Fingerprint::NUM_BANDS; ++b)
+            window.bands[size_t(b)] = powerToDecibels(power[size_t(b)]);
+
+        result.windows.push_back(window);
+    }
+    return result;
+}
+
+struct Difference
+{
+    float level = 0.0f;    // largest difference of any audible window
+    float spectrum = 0.0f; // average difference of the audible bands
+
+    bool isWithinTolerance() const
+    {
+        return level <= levelTolerance && spectrum <= spectrumTolerance;
+    }
+};
+
+Difference compare(const Fingerprint &render, const Fingerprint &reference)
+{
+    Difference difference;
+    if (render.windows.size() != reference.windows.size())
+    {
+        difference.level = std::numeric_limits<float>::infinity();
+        return difference;
+    }
+
+    // Very quiet windows and bands are left out, their level is mostly the
+    // noise of the rounding
+    double spectrumSum = 0.0;
+    int numBands = 0;
+
+    for (size_t w = 0; w < render.windows.size(); ++w)
+    {
+        const Fingerprint::Window &a = render.windows[w];
+        const Fingerprint::Window &b = reference.windows[w];
+
+        if (std::max(a.left, b.left) > -60.0f)
+            difference.level = std::max(difference.level, std::abs(a.left - b.left));
+        if (std::max(a.right, b.right) > -60.0f)
+            difference.level = std::max(difference.level, std::abs(a.right - b.right));
+
+        for (size_t i = 0; i < a.bands.size(); ++i)
+        {
+            if (std::max(a.bands[i], b.bands[i]) > -80.0f)
+            {
+                spectrumSum += double(std::abs(a.bands[i] - b.bands[i]));
+                numBands += 1;
+            }
+        }
+    }
+
+    if (numBands > 0)
+        difference.spectrum = float(spectrumSum / double(numBands));
+
+    return difference;
+}
+
+//==============================================================================
+/*
+ The reference file is text, one block per program and sample rate:
+   program <index> <sample rate> <number of windows>
+   <left dB> <right dB> <band dB>... for every window
+ followed by the render time of every program, as a multiple of the
+ calibration loop:
+   time <index> <render time>
+ */
+struct References
+{
+    std::map<std::pair<int, int>, Fingerprint> fingerprints; // by program and rate
+    std::map<int, double> renderTimes;
+
+    bool read(const juce::File &file)
+    {
+        juce::StringArray lines;
+        file.readLines(lines);
+
+        for (int i = 0; i < lines.size(); ++i)
+        {
+            juce::StringArray tokens = juce::StringArray::fromTokens(lines[i], false);
+            if (tokens.size() == 4 && tokens[0] == "program")
+            {
+                Fingerprint &print = fingerprints[{tokens[1].getIntValue(),
+                                                   tokens[2].getIntValue()}];
+                int numWindows = tokens[3].getIntValue();
+
+                for (int w = 0; w < numWindows && i + 1 < lines.size(); ++w)
+                {
+                    juce::StringArray values = juce::StringArray::fromTokens(lines[++i], false);
+                    if (values.size() != 2 + Fingerprint::NUM_BANDS)
+                        return false;
+
+                    Fingerprint::Window window;
+                    window.left = values[0].getFloatValue();
+                    window.right = values[1].getFloatValue();
+                    for (int b = 0; b < Fingerprint::NUM_BANDS; ++b)
+                        window.bands[size_t(b)] = values[2 + b].getFloatValue();
+
+                    print.windows.push_back(window);
+                }
+            }
+            else if (tokens.size() == 3 && tokens[0] == "time")
+            {
+                renderTimes[tokens[1].getIntValue()] = tokens[2].getDoubleValue();
+            }
+        }
+        return !fingerprints.empty();
+    }
+
+    bool write(const juce::File &file) const
+    {
+        juce::String text;
+        for (const auto &[key, print] : fingerprints)
+        {
+            text << "program " << key.first << " " << key.second << " "
+                 << int(print.windows.size()) << "\n";
+
+            for (const Fingerprint::Window &window : print.windows)
+            {
+                text << juce::String(window.left, 2) << " " << juce::String(window.right, 2);
+                for (float band : window.bands)
+                    text << " " << juce::String(band, 2);
+                text << "\n";
+            }
+        }
+
+        for (const auto &[program, time] : renderTimes)
+            text << "time " << program << " " << juce::String(time, 2) << "\n";
+
+        return file.replaceWithText(text);
+    }
+};
+
+int runGolden(const juce::File &file, bool update, double maxSlowdown)
+{
+    if (JX11AudioProcessor::presetBankFile().existsAsFile())
+    {
+        std::cout << "A preset bank replaces the built-in programs, move "
+                  << JX11AudioProcessor::presetBankFile().getFullPathName() << " away first\n";
+        return 1;
+    }
+
+    References references;
+    if (!update && !references.read(file))
+    {
+        std::cout << "Can't read the references in " << file.getFullPathName()
+                  << ", create them with --update\n";
+        return 1;
+    }
+
+    const int numPrograms = JX11AudioProcessor().getNumPrograms();
+    int failures = 0;
+
+    // Calibrated once more at the end, in case the machine was busy
+    double calibration = calibrationMilliseconds();
+    std::map<int, double> milliseconds;
+
+    for (int program = 0; program < numPrograms; ++program)
+    {
+        Difference worst;
+        bool missing = false;
+        double start = juce::Time::getMillisecondCounterHiRes();
+        juce::String name;
+
+        for (double sampleRate : goldenRates)
+        {
+            for (int blockSize : goldenBlockSizes)
+            {
+                JX11AudioProcessor processor;
+                processor.setCurrentProgram(program);
+                name = processor.getProgramName(program);
+
+                RenderSettings settings;
+                settings.sampleRate = sampleRate;
+                settings.blockSize = blockSize;
+                auto audio = render(processor, settings, goldenScript, goldenLength);
+                Fingerprint print = fingerprint(audio, sampleRate);
+
+                std::pair<int, int> key{program, int(sampleRate)};
+                if (update && blockSize == goldenBlockSizes[0])
+                {
+                    references.fingerprints[key] = print;
+                    continue;
+                }
+
+                auto reference = references.fingerprints.find(key);
+                if (reference == references.fingerprints.end())
+                {
+                    missing = true;
+                    continue;
+                }
+
+                Difference difference = compare(print, reference->second);
+                worst.level = std::max(worst.level, difference.level);
+                worst.spectrum = std::max(worst.spectrum, difference.spectrum);
+            }
+        }
+
+        double time = millisecondsSince(start);
+        milliseconds[program] = time;
+
+        bool failed = missing || !worst.isWithinTolerance();
+        failures += failed ? 1 : 0;
+
+        std::cout << juce::String(program).paddedLeft(' ', 2) << " " << name.paddedRight(' ', 24)
+                  << juce::String(juce::roundToInt(time)).paddedLeft(' ', 6) << " ms  level "
+                  << juce::String(worst.level, 2) << " dB, spectrum "
+                  << juce::String(worst.spectrum, 2) << " dB"
+                  << (missing ? "  NO REFERENCE" : "") << (failed ? "  FAILED" : "") << "\n";
+    }
+
+    calibration = std::min(calibration, calibrationMilliseconds());
+
+    // The total over all programs, a single program renders too quickly to
+    // time reliably
+    double renderTime = 0.0;
+    double referenceTime = 0.0;
+    for (const auto &[program, time] : milliseconds)
+    {
+        if (update)
+            references.renderTimes[program] = time / calibration;
+
+        renderTime += time / calibration;
+        if (references.renderTimes.count(program) > 0)
+            referenceTime += references.renderTimes[program];
+    }
+
+    std::cout << "Render time " << juce::String(renderTime, 1) << " x calibration ("
+              << juce::String(calibration, 1) << " ms)";
+    if (!update && referenceTime > 0.0)
+        std::cout << ", " << juce::String(renderTime / referenceTime, 2) << " x reference";
+    std::cout << "\n";
+
+    if (update)
+    {
+        if (!references.write(file))
+        {
+            std::cout << "Can't write " << file.getFullPathName() << "\n";
+            return 1;
+        }
+        std::cout << "Wrote the references of " << numPrograms << " programs\n";
+        return 0;
+    }
+
+    std::cout << failures << " of " << numPrograms << " programs failed\n";
+
+    bool tooSlow = maxSlowdown > 0.0 && referenceTime > 0.0 &&
+                   renderTime > maxSlowdown * referenceTime;
+    if (tooSlow)
+        std::cout << "Rendering is more than " << maxSlowdown
+                  << " times slower than the reference\n";
+
+    return (failures > 0 || tooSlow) ? 1 : 0;
+}
+
+//==============================================================================
+int runLoad()
+{
+    const int numPrograms = JX11AudioProcessor().getNumPrograms();
+    LoadStats total{};
+
+    std::cout << "Block load at 48 kHz, 256 samples per block\n";
+    for (int program = 0; program < numPrograms; ++program)
+    {
+        JX11AudioProcessor processor;
+        processor.setCurrentProgram(program);
+
+        RenderSettings settings;
+        settings.blockSize = 256;
+        render(processor, settings, goldenScript, goldenLength);
+
+        LoadStats stats = processor.getLoadStats();
+        std::cout << juce::String(program).paddedLeft(' ', 2) << " "
+                  << processor.getProgramName(program).paddedRight(' ', 24) << "max "
+                  << juce::String(100.0f * stats.maxLoad, 2) << "%, 99th percentile "
+                  << juce::String(100.0f * stats.percentile(0.99f), 2) << "%\n";
+
+        total.numBlocks += stats.numBlocks;
+        total.maxLoad = std::max(total.maxLoad, stats.maxLoad);
+        for (size_t i = 0; i < total.histogram.size(); ++i)
+            total.histogram[i] += stats.histogram[i];
+        for (size_t i = 0; i < total.overThreshold.size(); ++i)
+        {
+            total.thresholds[i] = stats.thresholds[i];
+            total.overThreshold[i] += stats.overThreshold[i];
+        }
+    }
+
+    std::cout << "All programs, " << juce::int64(total.numBlocks) << " blocks, max "
+              << juce::String(100.0f * total.maxLoad, 2) << "%\n";
+    for (size_t i = 0; i < total.histogram.size(); ++i)
+    {
+        if (total.histogram[i] > 0)
+        {
+            juce::String bin = juce::String("> 100%");
+            if (i + 1 < total.histogram.size())
+                bin = juce::String(int(5 * i)) + "-" + juce::String(int(5 * i + 5)) + "%";
+            std::cout << "  " << bin.paddedRight(' ', 10) << juce::int64(total.histogram[i])
+                      << "\n";
+        }
+    }
+    for (size_t i = 0; i < total.overThreshold.size(); ++i)
+    {
+        int threshold = juce::roundToInt(100.0f * total.thresholds[i]);
+        std::cout << "  over " << threshold << "%: " << juce::int64(total.overThreshold[i])
+                  << " blocks\n";
+    }
+    return 0;
+}
+
+int runProfile()
+{
+#if JX11_PROFILING
+    std::cout << "Every program at 48 kHz, 512 samples per block\n";
+
+    const int numPrograms = JX11AudioProcessor().getNumPrograms();
+    for (int program = 0; program < numPrograms; ++program)
+    {
+        JX11AudioProcessor processor;
+        processor.setCurrentProgram(program);
+
+        Profiler::reset();
+        render(processor, {}, goldenScript, goldenLength);
+        std::cout << "\n" << program << " " << processor.getProgramName(program) << "\n"
+                  << Profiler::report();
+    }
+    return 0;
+#else
+    std::cout << "Build with the JX11_PROFILING option to profile the DSP stages\n";
+    return 1;
+#endif
+}
+
+int runRealtimeChecks()
+{
+#if JX11_RT_CHECKS
+    // Program changes from MIDI on the main channel and, in multi mode, the
+    // second part
+    Script script = goldenScript;
+    script.push_back({0.05, 0xC0, 7, 0});
+    script.push_back({0.25, 0xC1, 12, 0});
+    script.push_back({0.70, 0xC0, 30, 0});
+    std::stable_sort(script.begin(), script.end(),
+                     [](const ScriptEvent &a, const ScriptEvent &b) { return a.time < b.time; });
+
+    for (bool offline : {false, true})
+    {
+        for (bool multi : {false, true})
+        {
+            JX11AudioProcessor processor;
+            auto *multiMode = processor.apvts.getParameter(ParameterID::multiMode.getParamID());
+            multiMode->setValueNotifyingHost(multi ? 1.0f : 0.0f);
+
+            RenderSettings settings;
+            settings.offline = offline;
+            render(processor, settings, script, goldenLength);
+
+            std::cout << (offline ? "Offline" : "Realtime") << (multi ? ", multi" : "")
+                      << ": " << RealtimeChecks::getNumViolations() << " violations so far\n";
+        }
+    }
+
+#if JX11_MIDI_STRESS
+    for (MidiStressMode mode :
+         {MidiStressMode::dense, MidiStressMode::random, MidiStressMode::adversarial})
+    {
+        JX11AudioProcessor processor;
+        processor.setMidiStress(mode);
+        render(processor, {}, goldenScript, goldenLength);
+
+        std::cout << "MIDI stress " << int(mode) << ": " << RealtimeChecks::getNumViolations()
+                  << " violations so far\n";
+    }
+#else
+    std::cout << "Build with the JX11_MIDI_STRESS option to include the stress runs\n";
+#endif
+
+    int numViolations = RealtimeChecks::getNumViolations();
+    std::cout << RealtimeChecks::report();
+    return (numViolations > 0) ? 1 : 0;
+#else
+    std::cout << "Build with the JX11_RT_CHECKS option to check the audio thread\n";
+    return 1;
+#endif
+}
+
+//==============================================================================
+int runState(int numInstances)
+{
+    std::vector<std::unique_ptr<JX11AudioProcessor>> instances;
+    for (int i = 0; i < numInstances; ++i)
+        instances.push_back(std::make_unique<JX11AudioProcessor>());
+
+    // A session where everything differs from the defaults
+    JX11AudioProcessor source;
+    source.setCurrentProgram(source.getNumPrograms() - 1);
+    source.setPartProgram(1, 5);
+
+    juce::MemoryBlock binaryState;
+    double start = juce::Time::getMillisecondCounterHiRes();
+    source.getStateInformation(binaryState);
+    double saveTime = millisecondsSince(start);
+
+    // What older versions of the plugin saved
+    juce::MemoryBlock xmlState;
+    juce::ValueTree tree = source.apvts.copyState();
+    tree.setProperty("partPrograms", "5", nullptr);
+    juce::AudioProcessor::copyXmlToBinary(*tree.createXml(), xmlState);
+
+    std::cout << "Binary state " << int(binaryState.getSize()) << " bytes, saved in "
+              << juce::String(1000.0 * saveTime, 1) << " us\n";
+    std::cout << "XML state " << int(xmlState.getSize()) << " bytes\n";
+
+    int totalMismatches = 0;
+    for (const juce::MemoryBlock *state : {&binaryState, &xmlState})
+    {
+        start = juce::Time::getMillisecondCounterHiRes();
+        for (auto &instance : instances)
+            instance->setStateInformation(state->getData(), int(state->getSize()));
+        double time = millisecondsSince(start);
+
+        int mismatches = 0;
+        for (auto &instance : instances)
+        {
+            const auto &params = instance->getParameters();
+            for (int p = 0; p < params.size(); ++p)
+            {
+                if (std::abs(params[p]->getValue() - source.getParameters()[p]->getValue()) >
+                    1.0e-6f)
+                    mismatches += 1;
+            }
+            mismatches += (instance->getPartProgram(1) == 5) ? 0 : 1;
+        }
+
+        std::cout << ((state == &binaryState) ? "Binary" : "XML   ") << " load: "
+                  << juce::String(1000.0 * time / double(numInstances), 1)
+                  << " us per instance over " << numInstances << " instances, " << mismatches
+                  << " values differ\n";
+        totalMismatches += mismatches;
+    }
+    return (totalMismatches > 0) ? 1 : 0;
+}
+
+// Resident memory of the process in kB, or -1 where it can't be read
+juce::int64 residentMemory()
+{
+#if JUCE_LINUX
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+            return std::stoll(line.substr(6));
+    }
+#endif
+    return -1;
+}
+
+int runStartup(int numInstances)
+{
+    std::vector<std::unique_ptr<JX11AudioProcessor>> instances;
+    juce::int64 memoryBefore = residentMemory();
+
+    double start = juce::Time::getMillisecondCounterHiRes();
+    instances.push_back(std::make_unique<JX11AudioProcessor>());
+    double firstTime = millisecondsSince(start);
+
+    start = juce::Time::getMillisecondCounterHiRes();
+    for (int i = 1; i < numInstances; ++i)
+        instances.push_back(std::make_unique<JX11AudioProcessor>());
+    double restTime = millisecondsSince(start);
+
+    juce::int64 memoryAfter = residentMemory();
+
+    std::cout << "First instance: " << juce::String(firstTime, 2)
+              << " ms (builds the shared presets and tables)\n";
+    if (numInstances > 1)
+    {
+        std::cout << "Other instances: " << juce::String(restTime / double(numInstances - 1), 3)
+                  << " ms each\n";
+    }
+
+    if (memoryBefore >= 0 && memoryAfter >= 0)
+    {
+        std::cout << "Resident memory: " << (memoryAfter - memoryBefore) / numInstances
+                  << " kB per instance over " << numInstances << " instances\n";
+    }
+    else
+    {
+        std::cout << "Resident memory is not measured on this platform\n";
+    }
+    return 0;
+}
+
+//==============================================================================
+#if JUCE_LINUX
+// Counts L1 data cache read misses of this thread while it is alive
+class CacheMissCounter
+{
+  public:
+    CacheMissCounter()
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd < 0)
+            error = std::strerror(errno);
+    }
+
+    ~CacheMissCounter()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool isAvailable() const { return fd >= 0; }
+    const char *getError() const { return error; }
+
+    void start()
+    {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    uint64_t stop()
+    {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(fd, &count, sizeof(count)) != ssize_t(sizeof(count)))
+            return 0;
+        return count;
+    }
+
+  private:
+    int fd = -1;
+    const char *error = "";
+};
+#endif
+
+int runPolyphony()
+{
+    // Twelve notes for the first part and four for the second in multi
+    // mode, which leaves the second part enough idle voices if the first one
+    // keeps to its polyphony. Spread out, the earlier notes are past their
+    // attack when the later ones steal them. All at once, every voice is
+    // still in its attack.
+    const int numNotes[] = {12, 4};
+    const double spacings[] = {0.02, 0.0};
+    int failures = 0;
+
+    for (double spacing : spacings)
+    {
+        Script script;
+        double time = 0.0;
+        for (uint8_t channel = 0; channel < 2; ++channel)
+        {
+            for (uint8_t i = 0; i < numNotes[channel]; ++i)
+            {
+                script.push_back({time, uint8_t(0x90 | channel), uint8_t(48 + 2 * i), 100});
+                time += spacing;
+            }
+        }
+
+        JX11AudioProcessor processor;
+        auto *multiMode = processor.apvts.getParameter(ParameterID::multiMode.getParamID());
+        multiMode->setValueNotifyingHost(1.0f);
+
+        RenderSettings settings;
+        render(processor, settings, script, time + 0.1);
+
+        for (int part = 0; part < 2; ++part)
+        {
+            int voices = processor.getNumActiveVoices(part);
+            int expected = std::min(numNotes[part], Synth::MAX_POLYPHONY);
+            bool isCorrect = voices == expected;
+            failures += isCorrect ? 0 : 1;
+
+            std::cout << "Notes " << juce::roundToInt(1000.0 * spacing) << " ms apart, part "
+                      << part + 1 << ": " << voices << " voices, expected " << expected
+                      << (isCorrect ? "\n" : "  FAILED\n");
+        }
+    }
+    return (failures > 0) ? 1 : 0;
+}
+
+int runVoices()
+{
+    // Two parts in multi mode fill all voices. Held for the whole render.
+    Script script;
+    const uint8_t notes[] = {36, 43, 48, 52, 55, 60, 64, 67};
+    for (uint8_t channel = 0; channel < 2; ++channel)
+    {
+        for (uint8_t note : notes)
+            script.push_back({0.0, uint8_t(0x90 | channel), uint8_t(note + 12 * channel), 100});
+    }
+
+    const double seconds = 4.0;
+
+    // Unison is set on the first part only, the second one plays the Init
+    // program
+    struct Setup
+    {
+        OscillatorMode mode;
+        int unison;
+    };
+    const Setup setups[] = {{OscillatorMode::blit, 1},
+                            {OscillatorMode::table, 1},
+                            {OscillatorMode::blit, 7},
+                            {OscillatorMode::table, 7}};
+
+    for (const auto &[mode, unison] : setups)
+    {
+        JX11AudioProcessor processor;
+        auto *multiMode = processor.apvts.getParameter(ParameterID::multiMode.getParamID());
+        multiMode->setValueNotifyingHost(1.0f);
+        auto *unisonParam = processor.apvts.getParameter(ParameterID::unison.getParamID());
+        unisonParam->setValueNotifyingHost(unisonParam->convertTo0to1(float(unison)));
+        processor.setOscillatorMode(mode);
+
+        // Warm up the caches and the branch predictors first
+        RenderSettings settings;
+        render(processor, settings, script, 0.5);
+
+#if JUCE_LINUX
+        CacheMissCounter counter;
+        if (counter.isAvailable())
+            counter.start();
+#endif
+        double start = juce::Time::getMillisecondCounterHiRes();
+        render(processor, settings, script, seconds);
+        double time = millisecondsSince(start);
+
+        double samples = seconds * settings.sampleRate;
+        std::cout << ((mode == OscillatorMode::blit) ? "BLIT " : "Table") << " oscillators, "
+                  << "unison " << unison << ", " << Synth::MAX_VOICES << " voices: "
+                  << juce::String(1.0e6 * time / samples, 1) << " ns per sample, "
+                  << juce::String(1.0e6 * time / (samples * Synth::MAX_VOICES), 1)
+                  << " ns per voice and sample\n";
+
+#if JUCE_LINUX
+        if (counter.isAvailable())
+        {
+            uint64_t misses = counter.stop();
+            std::cout << "  L1 data cache read misses: "
+                      << juce::String(double(misses) / samples, 3) << " per sample\n";
+        }
+        else
+        {
+            std::cout << "  L1 data cache misses unavailable (perf_event_open: "
+                      << counter.getError() << ")\n";
+        }
+#endif
+    }
+    return 0;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args(argv + 1, argc - 1);
+    juce::String mode = args[0];
+    int instances = (args.size() > 1) ? std::max(1, args[1].getIntValue()) : 100;
+
+    if (mode == "golden" && args.size() >= 2)
+    {
+        int slowdownArg = args.indexOf("--max-slowdown");
+        double maxSlowdown = (slowdownArg > 0) ? args[slowdownArg + 1].getDoubleValue() : 0.0;
+        juce::File file = juce::File::getCurrentWorkingDirectory().getChildFile(args[1]);
+        return runGolden(file, args.contains("--update"), maxSlowdown);
+    }
+    if (mode == "load")
+        return runLoad();
+    if (mode == "profile")
+        return runProfile();
+    if (mode == "rtcheck")
+        return runRealtimeChecks();
+    if (mode == "state")
+        return runState(instances);
+    if (mode == "startup")
+        return runStartup(instances);
+    if (mode == "polyphony")
+        return runPolyphony();
+    if (mode == "voices")
+        return runVoices();
+
+    std::cout << "Usage: JX11Bench golden <file> [--update] [--max-slowdown <ratio>]\n"
+                 "       JX11Bench load | polyphony | profile | rtcheck | voices\n"
+                 "       JX11Bench state | startup [instances]\n";
+    return 2;
+}
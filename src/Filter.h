@@ -11,21 +11,116 @@
 #pragma once
 
 #include <juce_dsp/juce_dsp.h>
+#include "Oscillator.h"
 
-class Filter : public juce::dsp::LadderFilter<float>
+// tanh(x) over [-5, 5], shared by all filters
+using SaturationTable = juce::dsp::LookupTableTransform<float>;
+
+/*
+ Transistor ladder filter, 12 dB/octave low-pass. This is the algorithm of
+ juce::dsp::LadderFilter in LPF12 mode with the same drive and 50 ms
+ smoothing, kept here so that audio-rate modulation can set the cutoff on
+ every sample without going through the smoother.
+ */
+class Filter
 {
   public:
+    Filter()
+    {
+        setSampleRate(1000.0f);
+        setDrive(1.2f);
+        updateCoefficients(200.0f, 0.0f);
+        reset();
+    }
+
+    // The table must outlive the filter, render() can't be called before
+    // prepare()
+    void prepare(const juce::dsp::ProcessSpec &spec, const SaturationTable &table)
+    {
+        saturation = &table;
+        setSampleRate(float(spec.sampleRate));
+        reset();
+    }
+
+    static std::shared_ptr<const SaturationTable> createSaturationTable()
+    {
+        return std::make_shared<const SaturationTable>([](float x) { return std::tanh(x); },
+                                                       -5.0f, 5.0f, 128);
+    }
+
+    void reset()
+    {
+        state.fill(0.0f);
+        cutoffSmoother.setCurrentAndTargetValue(cutoffSmoother.getTargetValue());
+        resonanceSmoother.setCurrentAndTargetValue(resonanceSmoother.getTargetValue());
+    }
+
     void updateCoefficients(float cutoff, float Q)
     {
-        setCutoffFrequencyHz(cutoff);
-        setResonance(std::clamp(Q / 30.0f, 0.0f, 1.0f));
+        cutoffHz = cutoff;
+        cutoffSmoother.setTargetValue(std::exp(cutoff * cutoffScale));
+        resonanceSmoother.setTargetValue(0.1f + 0.9f * std::clamp(Q / 30.0f, 0.0f, 1.0f));
     }
 
-    float render(float x)
+    // exp(cutoffScale * cutoff) is the coefficient that render() takes
+    float getCutoffScale() const { return cutoffScale; }
+
+    float render(float x) { return process(x, cutoffSmoother.getNextValue()); }
+
+    // Skips the cutoff smoothing, the smoother continues from this value
+    float render(float x, float cutoffTransform)
+    {
+        cutoffSmoother.setCurrentAndTargetValue(cutoffTransform);
+        return process(x, cutoffTransform);
+    }
+
+  private:
+    void setSampleRate(float sampleRate)
+    {
+        cutoffScale = -TAU / sampleRate;
+        cutoffSmoother.reset(sampleRate, 0.05);
+        resonanceSmoother.reset(sampleRate, 0.05);
+
+        // Like LadderFilter, recompute the coefficient of the last cutoff
+        // for the new sample rate
+        cutoffSmoother.setTargetValue(std::exp(cutoffHz * cutoffScale));
+    }
+
+    void setDrive(float newDrive)
     {
-        updateSmoothers();
-        return processSample(x, 0);
+        drive = newDrive;
+        gain = std::pow(drive, -2.642f) * 0.6103f + 0.3903f;
+        drive2 = drive * 0.04f + 0.96f;
+        gain2 = std::pow(drive2, -2.642f) * 0.6103f + 0.3903f;
     }
+
+    float process(float x, float a1)
+    {
+        const SaturationTable &saturate = *saturation;
+        const float resonance = resonanceSmoother.getNextValue();
+
+        const float g = 1.0f - a1;
+        const float b0 = g * 0.76923076923f;
+        const float b1 = g * 0.23076923076f;
+
+        const float dx = gain * saturate(drive * x);
+        const float a = dx - 4.0f * resonance * (gain2 * saturate(drive2 * state[4]) - dx * 0.5f);
+        const float b = b1 * state[0] + a1 * state[1] + b0 * a;
+        const float c = b1 * state[1] + a1 * state[2] + b0 * b;
+        const float d = b1 * state[2] + a1 * state[3] + b0 * c;
+        const float e = b1 * state[3] + a1 * state[4] + b0 * d;
+
+        state = {a, b, c, d, e};
+        return c * 1.2f;
+    }
+
+    std::array<float, 5> state;
+    juce::LinearSmoothedValue<float> cutoffSmoother;
+    juce::LinearSmoothedValue<float> resonanceSmoother;
+    float drive, drive2, gain, gain2;
+    const SaturationTable *saturation = nullptr;
+    float cutoffScale;
+    float cutoffHz = 200.0f;
 };
 
 /*
@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    KeyState.h
+    Created: 19 Oct 2026 5:02:31pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "NoteStack.h"
+
+/*
+ The keys and pedals of one part. The voices themselves remember why they are
+ still sounding (see Voice::hold), these masks only say which notes have
+ voices that a pedal is holding on to, so that pedal-up and re-striking a
+ sustained note don't have to search the voices when there are none.
+ */
+struct KeyState
+{
+    NoteStack held;
+    NoteMask sustained;
+    NoteMask sostenuto;
+
+    bool sustainPedal;
+    bool sostenutoPedal;
+    bool softPedal;
+
+    void reset()
+    {
+        held.clear();
+        sustained.clear();
+        sostenuto.clear();
+        sustainPedal = false;
+        sostenutoPedal = false;
+        softPedal = false;
+    }
+};
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    LFO.h
+    Created: 19 Oct 2026 9:12:40am
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include "Oscillator.h"
+
+enum class LFOShape
+{
+    sine,
+    triangle,
+    sawUp,
+    sawDown,
+    square,
+    sampleAndHold,
+};
+
+/*
+ One period of a sine wave, shared by all LFOs so that a control-rate tick
+ costs a table lookup instead of a call to std::sin.
+ */
+class LFOTable
+{
+  public:
+    static constexpr int SIZE = 256;
+
+    LFOTable()
+    {
+        // One extra point so the interpolation never has to wrap
+        for (int i = 0; i <= SIZE; ++i)
+        {
+            sine[i] = std::sin(TAU * float(i) / float(SIZE));
+        }
+    }
+
+    // phase is normalized to [0, 1)
+    inline float sineAt(float phase) const
+    {
+        float pos = phase * float(SIZE);
+        int i = int(pos);
+        float frac = pos - float(i);
+        return sine[i] + frac * (sine[i + 1] - sine[i]);
+    }
+
+  private:
+    std::array<float, SIZE + 1> sine;
+};
+
+/*
+ The LFO only keeps its phase. Rate and shape are passed in on every tick so
+ that the per-voice LFOs don't each need a copy of the global settings.
+ */
+class LFO
+{
+  public:
+    void reset()
+    {
+        phase = 0.0f;
+        held = 0.0f;
+        seed = 22222;
+    }
+
+    // inc is in cycles per control-rate tick
+    float nextValue(float inc, LFOShape shape, const LFOTable &table)
+    {
+        phase += inc;
+
+        bool wrapped = false;
+        if (phase >= 1.0f)
+        {
+            phase -= std::floor(phase);
+            wrapped = true;
+        }
+
+        switch (shape)
+        {
+        case LFOShape::sine:
+            return table.sineAt(phase);
+        case LFOShape::triangle:
+            if (phase < 0.25f)
+                return 4.0f * phase;
+            else if (phase < 0.75f)
+                return 2.0f - 4.0f * phase;
+            else
+                return 4.0f * phase - 4.0f;
+        case LFOShape::sawUp:
+            return 2.0f * phase - 1.0f;
+        case LFOShape::sawDown:
+            return 1.0f - 2.0f * phase;
+        case LFOShape::square:
+            return (phase < 0.5f) ? 1.0f : -1.0f;
+        case LFOShape::sampleAndHold:
+            if (wrapped)
+            {
+                // Same generator as NoiseGenerator, mapped to [-1, 1]
+                seed = seed * 196314165 + 907633515;
+                held = float(seed >> 9) / 4194304.0f - 1.0f;
+            }
+            return held;
+        }
+        return 0.0f;
+    }
+
+  private:
+    float phase;
+    float held;
+    unsigned int seed;
+};
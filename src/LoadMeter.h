@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    LoadMeter.h
+    Created: 20 Oct 2026 9:35:12am
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+/*
+ How long the audio thread took per block, as a fraction of the block's
+ duration. A load above 1 means the block missed its deadline.
+ */
+struct LoadStats
+{
+    static constexpr int NUM_BINS = 21; // 5% wide, the last one is > 100%
+    static constexpr int NUM_THRESHOLDS = 3;
+
+    uint64_t numBlocks;
+    float lastLoad;
+    float maxLoad;
+    std::array<uint64_t, NUM_BINS> histogram;
+
+    // Number of blocks over each of the thresholds
+    std::array<float, NUM_THRESHOLDS> thresholds;
+    std::array<uint64_t, NUM_THRESHOLDS> overThreshold;
+
+    // Load that the given fraction of blocks stay under, rounded up to the
+    // histogram's resolution
+    float percentile(float fraction) const
+    {
+        uint64_t total = 0;
+        for (uint64_t count : histogram)
+            total += count;
+
+        uint64_t target = uint64_t(std::ceil(double(fraction) * double(total)));
+        uint64_t sum = 0;
+        for (int i = 0; i < NUM_BINS - 1; ++i)
+        {
+            sum += histogram[i];
+            if (sum >= target)
+                return std::min(float(i + 1) * 0.05f, maxLoad);
+        }
+        return maxLoad;
+    }
+};
+
+/*
+ Written by the audio thread only and read from anywhere. The counters are
+ relaxed atomics, so a snapshot may mix values from two neighbouring blocks.
+ */
+class LoadMeter
+{
+  public:
+    LoadMeter()
+    {
+        setThreshold(0, 0.5f);
+        setThreshold(1, 0.8f);
+        setThreshold(2, 1.0f);
+        clear();
+    }
+
+    // Audio thread, returns the block's load
+    float record(juce::int64 startTicks, juce::int64 endTicks, int numSamples, double sampleRate)
+    {
+        if (resetRequested.exchange(false, std::memory_order_relaxed))
+            clear();
+
+        if (numSamples <= 0 || sampleRate <= 0.0)
+            return 0.0f;
+
+        double seconds = juce::Time::highResolutionTicksToSeconds(endTicks - startTicks);
+        float load = float(seconds * sampleRate / double(numSamples));
+
+        int bin = std::min(int(load * 20.0f), LoadStats::NUM_BINS - 1);
+        increment(histogram[bin]);
+
+        for (int i = 0; i < LoadStats::NUM_THRESHOLDS; ++i)
+        {
+            if (load > thresholds[i].load(std::memory_order_relaxed))
+                increment(overThreshold[i]);
+        }
+
+        lastLoad.store(load, std::memory_order_relaxed);
+        if (load > maxLoad.load(std::memory_order_relaxed))
+            maxLoad.store(load, std::memory_order_relaxed);
+
+        increment(numBlocks);
+        return load;
+    }
+
+    LoadStats getStats() const
+    {
+        LoadStats stats;
+        stats.numBlocks = numBlocks.load(std::memory_order_relaxed);
+        stats.lastLoad = lastLoad.load(std::memory_order_relaxed);
+        stats.maxLoad = maxLoad.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < LoadStats::NUM_BINS; ++i)
+            stats.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+
+        for (int i = 0; i < LoadStats::NUM_THRESHOLDS; ++i)
+        {
+            stats.thresholds[i] = thresholds[i].load(std::memory_order_relaxed);
+            stats.overThreshold[i] = overThreshold[i].load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    // load is a fraction of the block duration
+    void setThreshold(int index, float load)
+    {
+        if (index >= 0 && index < LoadStats::NUM_THRESHOLDS)
+            thresholds[index].store(load, std::memory_order_relaxed);
+    }
+
+    // The counters are cleared by the audio thread at the next block
+    void reset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+  private:
+    // Only the audio thread writes, so this doesn't need a read-modify-write
+    static void increment(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        numBlocks.store(0, std::memory_order_relaxed);
+        lastLoad.store(0.0f, std::memory_order_relaxed);
+        maxLoad.store(0.0f, std::memory_order_relaxed);
+
+        for (auto &count : histogram)
+            count.store(0, std::memory_order_relaxed);
+
+        for (auto &count : overThreshold)
+            count.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> numBlocks;
+    std::atomic<float> lastLoad;
+    std::atomic<float> maxLoad;
+    std::array<std::atomic<uint64_t>, LoadStats::NUM_BINS> histogram;
+    std::array<std::atomic<float>, LoadStats::NUM_THRESHOLDS> thresholds;
+    std::array<std::atomic<uint64_t>, LoadStats::NUM_THRESHOLDS> overThreshold;
+    std::atomic<bool> resetRequested{false};
+};
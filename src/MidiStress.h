@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    MidiStress.h
+    Created: 20 Oct 2026 9:41:07am
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+// The generator is only compiled in with the JX11_MIDI_STRESS CMake option
+#ifndef JX11_MIDI_STRESS
+#define JX11_MIDI_STRESS 0
+#endif
+
+enum class MidiStressMode
+{
+    off,
+    dense,       // controller sweeps and pitch bend every few samples
+    random,      // random messages on random channels, including sysex
+    adversarial, // chords larger than the voice pool, pedal storms, all notes off
+};
+
+/*
+ Generates MIDI that is merged with the host's events, to find the worst-case
+ block time of the engine together with the load meter. The generator is
+ seeded so that a run can be repeated exactly.
+
+ Program changes and the volume controller are never generated, those change
+ the plugin's parameters and would not be undone when the stress test stops.
+ */
+class MidiStress
+{
+  public:
+    // Upper limit on the events added per block, so that the buffer they are
+    // generated into never needs to grow on the audio thread
+    static constexpr int MAX_EVENTS = 256;
+    static constexpr int BUFFER_BYTES = MAX_EVENTS * 32;
+
+    void reset(juce::int64 seed = 0x4A58313100LL)
+    {
+        random = juce::Random(seed);
+        sweep = 0;
+        noteOffset = 0;
+        sustainDown = false;
+    }
+
+    void generate(MidiStressMode mode, juce::MidiBuffer &buffer, int sampleCount)
+    {
+        numEvents = 0;
+        if (sampleCount <= 0)
+            return;
+
+        switch (mode)
+        {
+        case MidiStressMode::off:
+            break;
+        case MidiStressMode::dense:
+            generateDense(buffer, sampleCount);
+            break;
+        case MidiStressMode::random:
+            generateRandom(buffer, sampleCount);
+            break;
+        case MidiStressMode::adversarial:
+            generateAdversarial(buffer, sampleCount);
+            break;
+        }
+    }
+
+  private:
+    void add(juce::MidiBuffer &buffer, int position, uint8_t data0, uint8_t data1, uint8_t data2)
+    {
+        if (numEvents < MAX_EVENTS)
+        {
+            const uint8_t data[3] = {data0, data1, data2};
+            buffer.addEvent(data, 3, position);
+            ++numEvents;
+        }
+    }
+
+    void generateDense(juce::MidiBuffer &buffer, int sampleCount)
+    {
+        // Three events per step, every 4 samples or spread out further so
+        // that the sweep covers the whole block within MAX_EVENTS
+        const int maxSteps = (MAX_EVENTS - 2) / 3;
+        const int interval = std::max(4, (sampleCount + maxSteps - 1) / maxSteps);
+        const int steps = (sampleCount + interval - 1) / interval;
+
+        // Keep a few notes going so the sweeps have something to act on. The
+        // notes go first, they must not be dropped by the event limit.
+        if (sweep + steps > 0x7F)
+        {
+            add(buffer, 0, 0x90, uint8_t(48 + noteOffset), 100);
+            add(buffer, 0, 0x80, uint8_t(48 + ((noteOffset + 9) % 12)), 0);
+            noteOffset = (noteOffset + 1) % 12;
+        }
+
+        for (int pos = 0; pos < sampleCount; pos += interval)
+        {
+            sweep = (sweep + 1) & 0x7F;
+            add(buffer, pos, 0xB0, 0x4A, uint8_t(sweep));
+            add(buffer, pos, 0xB0, 0x01, uint8_t(0x7F - sweep));
+            add(buffer, pos, 0xE0, 0x00, uint8_t(sweep));
+        }
+    }
+
+    void generateRandom(juce::MidiBuffer &buffer, int sampleCount)
+    {
+        int count = random.nextInt(64);
+        for (int i = 0; i < count; ++i)
+        {
+            int pos = random.nextInt(sampleCount);
+
+            // A short sysex message now and then, the processor must skip it
+            if (random.nextInt(16) == 0)
+            {
+                const uint8_t sysex[6] = {0xF0, 0x7D, uint8_t(random.nextInt(128)),
+                                          uint8_t(random.nextInt(128)), 0x00, 0xF7};
+                buffer.addEvent(sysex, 6, pos);
+                ++numEvents;
+                continue;
+            }
+
+            static constexpr uint8_t statuses[] = {0x80, 0x90, 0xA0, 0xB0, 0xD0, 0xE0};
+            uint8_t status = statuses[random.nextInt(6)];
+            uint8_t channel = uint8_t(random.nextInt(16));
+            uint8_t data1 = uint8_t(random.nextInt(128));
+            uint8_t data2 = uint8_t(random.nextInt(128));
+            if (status == 0xB0 && data1 == 0x07)
+                data1 = 0x4A;
+
+            add(buffer, pos, status | channel, data1, data2);
+        }
+    }
+
+    void generateAdversarial(juce::MidiBuffer &buffer, int sampleCount)
+    {
+        // Twice as many notes as there are voices, all at the same time
+        int pos = random.nextInt(sampleCount);
+        for (int i = 0; i < 32; ++i)
+        {
+            add(buffer, pos, 0x90, uint8_t(36 + ((noteOffset + i * 7) % 72)), 127);
+        }
+        noteOffset = (noteOffset + 1) % 72;
+
+        // The sustain pedal toggled on every other sample for a stretch
+        int start = random.nextInt(sampleCount);
+        for (int p = start; p < sampleCount && p < start + 64; p += 2)
+        {
+            sustainDown = !sustainDown;
+            add(buffer, p, 0xB0, 0x40, sustainDown ? 127 : 0);
+        }
+
+        // Release everything at the very end of some blocks
+        if (random.nextInt(4) == 0)
+        {
+            add(buffer, sampleCount - 1, 0xB0, 0x40, 0);
+            add(buffer, sampleCount - 1, 0xB0, 0x7B, 0);
+            sustainDown = false;
+        }
+    }
+
+    juce::Random random;
+    int numEvents = 0;
+    int sweep = 0;
+    int noteOffset = 0;
+    bool sustainDown = false;
+};
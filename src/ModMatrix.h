@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    ModMatrix.h
+    Created: 19 Oct 2026 11:03:15am
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+
+enum class ModSource
+{
+    none, // constant 1.0, used as the "via" of an unscaled route
+    lfo1,
+    lfo2,
+    modWheel,
+    pressure,
+    filterCtl,
+    notePressure,
+    timbre,
+    count,
+};
+
+enum class ModDestination
+{
+    osc1Period,
+    osc2Period,
+    cutoff,
+    cutoffSmoothed, // goes through the filter zipper smoothing first
+    count,
+};
+
+struct ModRoute
+{
+    ModSource src;
+    ModSource via;
+    ModDestination dst;
+    float depth;
+};
+
+// The modulation routes of a single patch
+class ModRoutes
+{
+  public:
+    static constexpr int MAX_ROUTES = 16;
+
+    void clear() { numRoutes = 0; }
+
+    void add(ModSource src, ModSource via, ModDestination dst, float depth)
+    {
+        // Duplicate routes are merged so they only cost one operation
+        for (int i = 0; i < numRoutes; ++i)
+        {
+            ModRoute &route = routes[i];
+            if (route.src == src && route.via == via && route.dst == dst)
+            {
+                route.depth += depth;
+                return;
+            }
+        }
+
+        if (numRoutes < MAX_ROUTES)
+        {
+            routes[numRoutes++] = {src, via, dst, depth};
+        }
+    }
+
+    float depthOf(ModSource src, ModSource via, ModDestination dst) const
+    {
+        for (int i = 0; i < numRoutes; ++i)
+        {
+            const ModRoute &route = routes[i];
+            if (route.src == src && route.via == via && route.dst == dst)
+            {
+                return route.depth;
+            }
+        }
+        return 0.0f;
+    }
+
+    int size() const { return numRoutes; }
+
+    const ModRoute &operator[](int i) const { return routes[i]; }
+
+  private:
+    std::array<ModRoute, MAX_ROUTES> routes;
+    int numRoutes = 0;
+};
+
+/*
+ Routes are compiled into a flat list of (source, via, destination, depth)
+ operations. Every operation runs over all lanes (one lane per voice) of the
+ contiguous source and destination rows, so the cost per tick is a fixed
+ multiply-add per route and lane that the compiler can vectorize. The depth
+ is stored per lane because each lane may be playing a different patch.
+ */
+template <int NUM_LANES> class ModMatrix
+{
+  public:
+    static constexpr int NUM_SOURCES = int(ModSource::count);
+    static constexpr int NUM_DESTINATIONS = int(ModDestination::count);
+    static constexpr int MAX_OPS = 32;
+
+    using Row = std::array<float, NUM_LANES>;
+
+    ModMatrix()
+    {
+        for (auto &row : sources)
+            row.fill(0.0f);
+
+        for (auto &row : destinations)
+            row.fill(0.0f);
+
+        sources[int(ModSource::none)].fill(1.0f);
+        numOps = 0;
+    }
+
+    inline float *source(ModSource s) { return sources[int(s)].data(); }
+
+    inline const float *destination(ModDestination d) const { return destinations[int(d)].data(); }
+
+    /*
+     Creates an operation for every route used by any of the patches, then
+     fills in the depths of each lane from the patch it is playing.
+     */
+    void compile(const ModRoutes *const *patches, int numPatches, const int *lanePatch)
+    {
+        numOps = 0;
+        for (int d = 0; d < NUM_DESTINATIONS; ++d)
+        {
+            for (int p = 0; p < numPatches; ++p)
+            {
+                const ModRoutes &routes = *patches[p];
+                for (int i = 0; i < routes.size(); ++i)
+                {
+                    const ModRoute &route = routes[i];
+                    if (int(route.dst) == d && route.depth != 0.0f && !hasOp(route))
+                    {
+                        addOp(route);
+                    }
+                }
+            }
+        }
+
+        for (int lane = 0; lane < NUM_LANES; ++lane)
+        {
+            setLaneRoutes(lane, *patches[lanePatch[lane]]);
+        }
+    }
+
+    // Used when a lane starts playing a different patch
+    void setLaneRoutes(int lane, const ModRoutes &routes)
+    {
+        for (int i = 0; i < numOps; ++i)
+        {
+            Op &op = ops[i];
+            op.depth[lane] = routes.depthOf(ModSource(op.src), ModSource(op.via),
+                                            ModDestination(op.dst));
+        }
+    }
+
+    // Lanes from numLanes onwards are not updated
+    void process(int numLanes = NUM_LANES)
+    {
+        for (auto &row : destinations)
+            row.fill(0.0f);
+
+        for (int i = 0; i < numOps; ++i)
+        {
+            const Op &op = ops[i];
+            const float *depth = op.depth.data();
+            const float *src = sources[op.src].data();
+            const float *via = sources[op.via].data();
+            float *dst = destinations[op.dst].data();
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                dst[lane] += depth[lane] * src[lane] * via[lane];
+            }
+        }
+    }
+
+  private:
+    struct Op
+    {
+        alignas(16) Row depth;
+        int src;
+        int via;
+        int dst;
+    };
+
+    bool hasOp(const ModRoute &route) const
+    {
+        for (int i = 0; i < numOps; ++i)
+        {
+            const Op &op = ops[i];
+            if (op.src == int(route.src) && op.via == int(route.via) && op.dst == int(route.dst))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void addOp(const ModRoute &route)
+    {
+        if (numOps < MAX_OPS)
+        {
+            Op &op = ops[numOps++];
+            op.src = int(route.src);
+            op.via = int(route.via);
+            op.dst = int(route.dst);
+            op.depth.fill(0.0f);
+        }
+    }
+
+    alignas(16) std::array<Row, NUM_SOURCES> sources;
+    alignas(16) std::array<Row, NUM_DESTINATIONS> destinations;
+
+    std::array<Op, MAX_OPS> ops;
+    int numOps;
+};
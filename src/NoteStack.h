@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    NoteStack.h
+    Created: 19 Oct 2026 4:12:08pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// Which of the held notes a mono part plays
+enum class NotePriority
+{
+    last,
+    low,
+    high,
+};
+
+// One bit for each MIDI note number
+class NoteMask
+{
+  public:
+    void clear() { bits.fill(0); }
+
+    void set(int note) { bits[note >> 6] |= uint64_t(1) << (note & 63); }
+
+    void reset(int note) { bits[note >> 6] &= ~(uint64_t(1) << (note & 63)); }
+
+    bool test(int note) const { return (bits[note >> 6] >> (note & 63)) & 1; }
+
+    bool any() const { return (bits[0] | bits[1]) != 0; }
+
+    // Both return -1 if no bits are set
+    int lowest() const
+    {
+        if (bits[0] != 0)
+            return std::countr_zero(bits[0]);
+        if (bits[1] != 0)
+            return 64 + std::countr_zero(bits[1]);
+        return -1;
+    }
+
+    int highest() const
+    {
+        if (bits[1] != 0)
+            return 127 - std::countl_zero(bits[1]);
+        if (bits[0] != 0)
+            return 63 - std::countl_zero(bits[0]);
+        return -1;
+    }
+
+  private:
+    std::array<uint64_t, 2> bits{};
+};
+
+/*
+ The keys that are held down, in the order they were pressed. The order is a
+ doubly linked list indexed by note number and a NoteMask keeps track of which
+ notes are in it, so pushing, removing and finding the lowest or highest note
+ take constant time no matter how many keys are down.
+ */
+class NoteStack
+{
+  public:
+    static constexpr int NUM_NOTES = 128;
+
+    void clear()
+    {
+        held.clear();
+        top = -1;
+        count = 0;
+    }
+
+    // A note that is already held moves to the top
+    void push(int note)
+    {
+        if (contains(note))
+            unlink(note);
+
+        prev[note] = int8_t(top);
+        next[note] = -1;
+        if (top >= 0)
+            next[top] = int8_t(note);
+        top = note;
+
+        held.set(note);
+        count += 1;
+    }
+
+    void remove(int note)
+    {
+        if (contains(note))
+            unlink(note);
+    }
+
+    bool contains(int note) const { return held.test(note); }
+
+    bool isEmpty() const { return count == 0; }
+
+    int size() const { return count; }
+
+    // All of these return -1 if no notes are held
+    int last() const { return top; }
+
+    int lowest() const { return held.lowest(); }
+
+    int highest() const { return held.highest(); }
+
+    int select(NotePriority priority) const
+    {
+        switch (priority)
+        {
+        case NotePriority::low:
+            return lowest();
+        case NotePriority::high:
+            return highest();
+        case NotePriority::last:
+            break;
+        }
+        return last();
+    }
+
+  private:
+    void unlink(int note)
+    {
+        if (prev[note] >= 0)
+            next[prev[note]] = next[note];
+        if (next[note] >= 0)
+            prev[next[note]] = prev[note];
+        else
+            top = prev[note];
+
+        held.reset(note);
+        count -= 1;
+    }
+
+    NoteMask held;
+    std::array<int8_t, NUM_NOTES> prev;
+    std::array<int8_t, NUM_NOTES> next;
+    int top = -1;
+    int count = 0;
+};
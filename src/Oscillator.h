@@ -10,12 +10,20 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 const float TAU = 6.2831853071795864f;
 const float PI_OVER_4 = 0.7853981633974483f;
 const float PI = 3.1415926535897932f;
 
+enum class OscillatorMode
+{
+    blit,  // band-limited impulse train, integrated by the voice
+    table, // 32-bit phase accumulator reading SawTables
+};
+
 class Oscillator
 {
   public:
@@ -81,9 +89,17 @@ class Oscillator
         return output - dc;
     }
 
+    // Phase increment per sample in table mode, see Voice::renderTableLanes()
+    inline uint32_t tableIncrement() const
+    {
+        float cycles = std::clamp(1.0f / (period * modulation), 0.0f, 0.5f);
+        return uint32_t(int64_t(cycles * 4294967296.0f));
+    }
+
     void squareWave(Oscillator &other, float newPeriod)
     {
         reset();
+
         if (other.inc > 0.0f)
         {
             phase = other.phaseMax + other.phaseMax - other.phase;
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    Part.h
+    Created: 19 Oct 2026 1:47:22pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "LFO.h"
+#include "ModMatrix.h"
+#include "KeyState.h"
+#include "Voice.h"
+
+/*
+ Everything that belongs to a single patch: the parameters derived from its
+ preset and the performance state of the MIDI channel that plays it. All
+ parts share the voices of the Synth.
+ */
+struct Part
+{
+    bool ignoreVelocity;
+
+    float noiseMix;
+    float envAttack;
+    float envDecay;
+    float envSustain;
+    float envRelease;
+    float detune;
+    float oscMix;
+    float tune;
+    float volumeTrim;
+    float velocitySensitivity;
+    float lfoInc;
+    LFOShape lfoShape;
+    float lfo2Inc;
+    LFOShape lfo2Shape;
+    float lfo2Depth;
+    float vibrato;
+    float pwmDepth;
+    float glideRate;
+    float glideBend;
+    float filterKeytracking;
+    float filterQ;
+    float filterLFODepth;
+    float filterAttack, filterDecay, filterSustain, filterRelease;
+    float filterEnvDepth;
+
+    int numUnison;
+    float unisonSpread;
+    float unisonGain;
+
+    // Period multiplier of each oscillator in the unison stack, and the
+    // smallest of them
+    std::array<float, Voice::MAX_UNISON> unisonDetune;
+    float unisonLowest;
+
+    juce::LinearSmoothedValue<float> outputLevelSmoother;
+
+    int numVoices;
+    int glideMode;
+    NotePriority notePriority;
+
+    ModRoutes modRoutes;
+
+    // Performance state
+    KeyState keys;
+
+    int lastNote;
+    int monoVoice;
+
+    float pitchBend;
+    float modWheel;
+    float pressure;
+    float filterCtl;
+
+    LFO lfo;
+
+    void reset(float sampleRate)
+    {
+        pitchBend = 1.0f;
+        keys.reset();
+        outputLevelSmoother.reset(sampleRate, 0.05);
+        lfo.reset();
+        modWheel = 0.0f;
+        lastNote = 0;
+        monoVoice = -1;
+        pressure = 0.0f;
+        filterCtl = 0.0f;
+    }
+};
@@ -23,12 +23,35 @@ JX11AudioProcessorEditor::JX11AudioProcessorEditor(JX11AudioProcessor &p)
     polyModeButton.setClickingTogglesState(true);
     addAndMakeVisible(polyModeButton);
 
+    addAndMakeVisible(telemetryView);
+    addAndMakeVisible(loadLabel);
+
+    autoQualityButton.setButtonText("Auto quality");
+    autoQualityButton.setClickingTogglesState(true);
+    autoQualityButton.setToggleState(audioProcessor.isQualityGovernorEnabled(),
+                                     juce::dontSendNotification);
+    autoQualityButton.onClick = [this] {
+        audioProcessor.setQualityGovernorEnabled(autoQualityButton.getToggleState());
+    };
+    addAndMakeVisible(autoQualityButton);
+
+    qualityLabel.setColour(juce::Label::textColourId, juce::Colours::orange);
+    addAndMakeVisible(qualityLabel);
+    updateQualityLabel(audioProcessor.getQualityTier());
+
+    audioProcessor.setTelemetryEnabled(true);
+    startTimerHz(30);
+
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
     setSize(600, 400);
 }
 
-JX11AudioProcessorEditor::~JX11AudioProcessorEditor() {}
+JX11AudioProcessorEditor::~JX11AudioProcessorEditor()
+{
+    stopTimer();
+    audioProcessor.setTelemetryEnabled(false);
+}
 
 //==============================================================================
 void JX11AudioProcessorEditor::paint(juce::Graphics &g)
@@ -46,4 +69,66 @@ void JX11AudioProcessorEditor::resized()
 
     polyModeButton.setSize(80, 30);
     polyModeButton.setCentrePosition(r.withX(r.getRight()).getCentre());
+
+    loadLabel.setBounds(280, 20, 300, 30);
+    autoQualityButton.setBounds(280, 60, 100, 30);
+    qualityLabel.setBounds(390, 60, 190, 30);
+    telemetryView.setBounds(20, 160, 560, 220);
+}
+
+void JX11AudioProcessorEditor::timerCallback()
+{
+    // Automation is shown at the timer's rate, however often the host sends it
+    outputLevelAttachment.update();
+    filterResoAttachment.update();
+
+    // Shown straight away, the user should know why the sound has changed
+    int tier = audioProcessor.getQualityTier();
+    if (tier != shownTier)
+        updateQualityLabel(tier);
+
+    TelemetryFrame frame;
+    bool newFrames = false;
+
+    while (audioProcessor.readTelemetry(frame))
+    {
+        telemetryView.addFrame(frame);
+        newFrames = true;
+    }
+
+    if (newFrames)
+        telemetryView.repaint();
+
+    // Readable numbers don't need to change 30 times per second
+    if (++loadUpdateCount >= 10)
+    {
+        loadUpdateCount = 0;
+
+        LoadStats stats = audioProcessor.getLoadStats();
+        int last = LoadStats::NUM_THRESHOLDS - 1;
+        const ProtectionStats &protection = audioProcessor.getProtectionStats();
+        loadLabel.setText("CPU " + juce::String(100.0f * stats.lastLoad, 1) + "%  p99 " +
+                              juce::String(100.0f * stats.percentile(0.99f), 1) + "%  max " +
+                              juce::String(100.0f * stats.maxLoad, 1) + "%  late " +
+                              juce::String(juce::int64(stats.overThreshold[last])) + "  clip " +
+                              juce::String(protection.clamped.load()) + "  nan " +
+                              juce::String(protection.nan.load() + protection.inf.load()),
+                          juce::dontSendNotification);
+    }
+}
+
+void JX11AudioProcessorEditor::updateQualityLabel(int tier)
+{
+    shownTier = tier;
+
+    if (tier == 0)
+    {
+        qualityLabel.setText({}, juce::dontSendNotification);
+        return;
+    }
+
+    const QualityTier &limits = QualityGovernor::tiers[size_t(tier)];
+    qualityLabel.setText("Reduced quality: " + juce::String(limits.maxUnison) + " unison, " +
+                             juce::String(limits.maxPolyphony) + " voices",
+                         juce::dontSendNotification);
 }
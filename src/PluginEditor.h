@@ -14,6 +14,7 @@
 
 #include "PluginProcessor.h"
 #include "RotaryKnob.h"
+#include "TelemetryView.h"
 
 using APVTS = juce::AudioProcessorValueTreeState;
 using SliderAttachment = APVTS::SliderAttachment;
@@ -22,7 +23,7 @@ using ButtonAttachment = APVTS::ButtonAttachment;
 //==============================================================================
 /**
  */
-class JX11AudioProcessorEditor : public juce::AudioProcessorEditor
+class JX11AudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer
 {
   public:
     JX11AudioProcessorEditor(JX11AudioProcessor &);
@@ -38,16 +39,28 @@ class JX11AudioProcessorEditor : public juce::AudioProcessorEditor
     JX11AudioProcessor &audioProcessor;
 
     RotaryKnob outputLevelKnob;
-    SliderAttachment outputLevelAttachment{
-        audioProcessor.apvts, ParameterID::outputLevel.getParamID(), outputLevelKnob.slider};
+    KnobAttachment outputLevelAttachment{audioProcessor.apvts, ParameterID::outputLevel,
+                                         outputLevelKnob};
 
     RotaryKnob filterResoKnob;
-    SliderAttachment filterResoAttachment{
-        audioProcessor.apvts, ParameterID::filterReso.getParamID(), filterResoKnob.slider};
+    KnobAttachment filterResoAttachment{audioProcessor.apvts, ParameterID::filterReso,
+                                        filterResoKnob};
 
     juce::TextButton polyModeButton;
     ButtonAttachment polyModeAttachment{audioProcessor.apvts, ParameterID::polyMode.getParamID(),
                                         polyModeButton};
 
+    TelemetryView telemetryView;
+    juce::Label loadLabel;
+    int loadUpdateCount = 0;
+
+    juce::TextButton autoQualityButton;
+    juce::Label qualityLabel;
+    int shownTier = 0;
+
+    void updateQualityLabel(int tier);
+
+    void timerCallback() override;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JX11AudioProcessorEditor)
 };
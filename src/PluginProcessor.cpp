@@ -9,18 +9,45 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "Utils.h"
+#include "RealtimeChecks.h"
+
+/*
+ Binary state, all values little-endian:
+   magic, version, number of parameters,
+   (FNV-1a hash of the parameter ID, value) for every parameter,
+   number of part programs, program of parts 2 and up.
+ Later versions may only append to this, so older readers can still load
+ what they know. Parameters are stored as plain (not normalized) values, like
+ the XML state.
+ */
+static const int STATE_MAGIC = 0x3131584A; // "JX11"
+static const int STATE_VERSION = 1;
 
 //==============================================================================
-JX11AudioProcessor::JX11AudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-    : AudioProcessor(BusesProperties()
+JX11AudioProcessor::BusesProperties JX11AudioProcessor::createBusesProperties()
+{
+    BusesProperties buses = BusesProperties()
 #if !JucePlugin_IsMidiEffect
 #if !JucePlugin_IsSynth
-                         .withInput("Input", juce::AudioChannelSet::stereo(), true)
+                                .withInput("Input", juce::AudioChannelSet::stereo(), true)
 #endif
-                         .withOutput("Output", juce::AudioChannelSet::stereo(), true)
+                                .withOutput("Output", juce::AudioChannelSet::stereo(), true)
 #endif
-      )
+        ;
+
+    // Optional outputs for the parts in multi mode, a part whose output is
+    // not enabled plays through the main output
+    for (int p = 1; p < Synth::MAX_PARTS; ++p)
+    {
+        buses = buses.withOutput("Part " + juce::String(p + 1), juce::AudioChannelSet::stereo(),
+                                 false);
+    }
+    return buses;
+}
+
+JX11AudioProcessor::JX11AudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+    : AudioProcessor(createBusesProperties())
 #endif
 {
     castParameter(apvts, ParameterID::oscMix, oscMixParam);
@@ -49,11 +76,81 @@ JX11AudioProcessor::JX11AudioProcessor()
     castParameter(apvts, ParameterID::tuning, tuningParam);
     castParameter(apvts, ParameterID::outputLevel, outputLevelParam);
     castParameter(apvts, ParameterID::polyMode, polyModeParam);
+    castParameter(apvts, ParameterID::lfoShape, lfoShapeParam);
+    castParameter(apvts, ParameterID::lfo2Rate, lfo2RateParam);
+    castParameter(apvts, ParameterID::lfo2Shape, lfo2ShapeParam);
+    castParameter(apvts, ParameterID::lfo2Depth, lfo2DepthParam);
+    castParameter(apvts, ParameterID::unison, unisonParam);
+    castParameter(apvts, ParameterID::unisonDetune, unisonDetuneParam);
+    castParameter(apvts, ParameterID::unisonSpread, unisonSpreadParam);
+    castParameter(apvts, ParameterID::notePriority, notePriorityParam);
+    castParameter(apvts, ParameterID::mpeMode, mpeModeParam);
+    castParameter(apvts, ParameterID::multiMode, multiModeParam);
+
+    presetParams = {
+        oscMixParam,      oscTuneParam,       oscFineParam,        glideModeParam,
+        glideRateParam,   glideBendParam,     filterFreqParam,     filterResoParam,
+        filterEnvParam,   filterLFOParam,     filterVelocityParam, filterAttackParam,
+        filterDecayParam, filterSustainParam, filterReleaseParam,  envAttackParam,
+        envDecayParam,    envSustainParam,    envReleaseParam,     lfoRateParam,
+        vibratoParam,     noiseParam,         octaveParam,         tuningParam,
+        outputLevelParam, polyModeParam,      lfoShapeParam,       lfo2RateParam,
+        lfo2ShapeParam,   lfo2DepthParam,     unisonParam,         unisonDetuneParam,
+        unisonSpreadParam, notePriorityParam,
+    };
+
+    stateParams.reserve(size_t(getParameters().size()));
+    stateParamHashes.reserve(size_t(getParameters().size()));
+
+    for (auto *parameter : getParameters())
+    {
+        // All parameters come from the APVTS, so they are ranged
+        auto *param = static_cast<juce::RangedAudioParameter *>(parameter);
+        jassert(dynamic_cast<juce::RangedAudioParameter *>(parameter) != nullptr);
+
+        uint32_t hash = hashString(param->paramID.toRawUTF8());
+        jassert(std::find(stateParamHashes.begin(), stateParamHashes.end(), hash) ==
+                stateParamHashes.end());
+
+        stateParams.push_back(param);
+        stateParamHashes.push_back(hash);
+    }
+
+    for (auto &program : partProgram)
+        program.store(0);
+    midiPartProgram.fill(-1);
+
+    outputChannel.fill(-1);
 
     apvts.state.addListener(this);
 
-    createPrograms();
+    // Only the first instance in the process builds the presets and opens
+    // the bank file
+    bank = SharedTables::get<PresetBank>({0.0, 0}, [this] {
+        auto newBank = std::make_shared<PresetBank>(createPrograms());
+        newBank->open(presetBankFile(), presetParamHashes());
+        return newBank;
+    });
+
+    const Preset init = bank->getPreset(0);
+    for (auto &params : partParams)
+        std::copy(init.param, init.param + NUM_PARAMS, params.begin());
+
     setCurrentProgram(0);
+
+    juce::String traceFile = juce::SystemStats::getEnvironmentVariable("JX11_TRACE", {});
+    if (traceFile.isNotEmpty())
+        startTrace(juce::File(traceFile));
+
+#if JX11_MIDI_STRESS
+    juce::String stressMode = juce::SystemStats::getEnvironmentVariable("JX11_MIDI_STRESS", {});
+    if (stressMode == "dense")
+        setMidiStress(MidiStressMode::dense);
+    else if (stressMode == "random")
+        setMidiStress(MidiStressMode::random);
+    else if (stressMode == "adversarial")
+        setMidiStress(MidiStressMode::adversarial);
+#endif
 }
 
 JX11AudioProcessor::~JX11AudioProcessor() { apvts.state.removeListener(this); }
@@ -90,47 +187,92 @@ bool JX11AudioProcessor::isMidiEffect() const
 
 double JX11AudioProcessor::getTailLengthSeconds() const { return 0.0; }
 
-int JX11AudioProcessor::getNumPrograms() { return int(presets.size()); }
+int JX11AudioProcessor::getNumPrograms() { return bank->size(); }
 
 int JX11AudioProcessor::getCurrentProgram() { return currentProgram; }
 
 void JX11AudioProcessor::setCurrentProgram(int index)
 {
-    currentProgram = index;
+    // Hosts may call this from yet another thread, those calls aren't traced
+    auto producer =
+        traceRecorder.producerFor(juce::MessageManager::existsAndIsCurrentThread());
+    ScopedTrace trace(traceRecorder, producer, TraceEvent::programChange, index);
 
-    juce::RangedAudioParameter *params[NUM_PARAMS] = {
-        oscMixParam,      oscTuneParam,       oscFineParam,        glideModeParam,
-        glideRateParam,   glideBendParam,     filterFreqParam,     filterResoParam,
-        filterEnvParam,   filterLFOParam,     filterVelocityParam, filterAttackParam,
-        filterDecayParam, filterSustainParam, filterReleaseParam,  envAttackParam,
-        envDecayParam,    envSustainParam,    envReleaseParam,     lfoRateParam,
-        vibratoParam,     noiseParam,         octaveParam,         tuningParam,
-        outputLevelParam, polyModeParam,
-    };
+    currentProgram = index;
 
-    const Preset &preset = presets[index];
+    const Preset preset = bank->getPreset(index);
 
+    // Only the parameters that change are sent to the host. When the plugin
+    // is created this skips everything, Init has the default values.
     for (int i = 0; i < NUM_PARAMS; ++i)
     {
-        params[i]->setValueNotifyingHost(params[i]->convertTo0to1(preset.param[i]));
+        float value = presetParams[i]->convertTo0to1(preset.param[i]);
+        if (value != presetParams[i]->getValue())
+            presetParams[i]->setValueNotifyingHost(value);
     }
 
     reset();
 }
 
-const juce::String JX11AudioProcessor::getProgramName(int index) { return {presets[index].name}; }
+const juce::String JX11AudioProcessor::getProgramName(int index) { return bank->getName(index); }
 
 void JX11AudioProcessor::changeProgramName(int /*index*/, const juce::String & /*newName*/)
 {
     // not implemented
 }
 
+void JX11AudioProcessor::setControlRateDecimation(int samples)
+{
+    controlRateDecimation.store(std::clamp(samples, Synth::MIN_LFO_MAX, Synth::MAX_LFO_MAX));
+    parametersChanged.store(true);
+}
+
+void JX11AudioProcessor::setOfflineControlRateDecimation(int samples)
+{
+    offlineDecimation.store(std::clamp(samples, Synth::MIN_LFO_MAX, Synth::MAX_LFO_MAX));
+    parametersChanged.store(true);
+}
+
+void JX11AudioProcessor::setAudioRateModulation(bool enabled)
+{
+    audioRateModulation.store(enabled);
+    parametersChanged.store(true);
+}
+
+void JX11AudioProcessor::setOscillatorMode(OscillatorMode mode)
+{
+    oscillatorMode.store(mode);
+    parametersChanged.store(true);
+}
+
+void JX11AudioProcessor::setPartProgram(int part, int index)
+{
+    if (part > 0 && part < Synth::MAX_PARTS && index >= 0 && index < bank->size())
+    {
+        const Preset preset = bank->getPreset(index);
+        {
+            const juce::SpinLock::ScopedLockType lock(partParamsLock);
+            std::copy(preset.param, preset.param + NUM_PARAMS, partParams[part].begin());
+        }
+        partProgram[part].store(index);
+        parametersChanged.store(true);
+    }
+}
+
 //==============================================================================
 void JX11AudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     synth.allocateResources(sampleRate, samplesPerBlock);
+#if JX11_MIDI_STRESS
+    stressMidi.ensureSize(MidiStress::BUFFER_BYTES);
+#endif
+    governor.reset();
+
+#if JX11_RT_CHECKS
+    RealtimeChecks::prepare();
+#endif
     parametersChanged.store(true);
     reset();
 }
@@ -140,6 +282,16 @@ void JX11AudioProcessor::releaseResources()
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
     synth.deallocateResources();
+
+#if JX11_PROFILING
+    juce::Logger::writeToLog(Profiler::report());
+    Profiler::reset();
+#endif
+
+#if JX11_RT_CHECKS
+    juce::Logger::writeToLog(RealtimeChecks::report());
+    RealtimeChecks::reset();
+#endif
 }
 
 void JX11AudioProcessor::reset()
@@ -147,7 +299,19 @@ void JX11AudioProcessor::reset()
     synth.reset();
 
     float outputLevel = juce::Decibels::decibelsToGain(outputLevelParam->get());
-    synth.outputLevelSmoother.setCurrentAndTargetValue(outputLevel);
+    synth.parts[0].outputLevelSmoother.setCurrentAndTargetValue(outputLevel);
+
+    // Can run on the audio thread from a program change. Without the lock
+    // the levels of the other parts glide to their targets instead.
+    const juce::SpinLock::ScopedTryLockType lock(partParamsLock);
+    if (lock.isLocked())
+    {
+        for (int p = 1; p < Synth::MAX_PARTS; ++p)
+        {
+            outputLevel = juce::Decibels::decibelsToGain(partParams[p][PresetParam::outputLevel]);
+            synth.parts[p].outputLevelSmoother.setCurrentAndTargetValue(outputLevel);
+        }
+    }
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -165,6 +329,14 @@ bool JX11AudioProcessor::isBusesLayoutSupported(const BusesLayout &layouts) cons
         layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
+    // The part outputs are either stereo or switched off
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        const juce::AudioChannelSet &channels = layouts.getChannelSet(false, bus);
+        if (!channels.isDisabled() && channels != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
         // This checks if the input layout matches the output layout
 #if !JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
@@ -179,6 +351,13 @@ bool JX11AudioProcessor::isBusesLayoutSupported(const BusesLayout &layouts) cons
 void JX11AudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
                                       juce::MidiBuffer &midiMessages)
 {
+    JX11_RT_SECTION();
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    traceRecorder.setAudioThread();
+    ScopedTrace trace(traceRecorder, TraceRecorder::audioThread, TraceEvent::processBlock,
+                      buffer.getNumSamples());
+
     juce::ScopedNoDenormals noDenormals;
 
     auto totalNumInputChannels = getTotalNumInputChannels();
@@ -193,11 +372,58 @@ void JX11AudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
+    // Switching between realtime and offline only changes the derived
+    // parameters, the voices keep playing
+    if (isNonRealtime() != renderingOffline)
+    {
+        renderingOffline = isNonRealtime();
+        governor.reset();
+        parametersChanged.store(true);
+    }
+
     bool expected = true;
     if (parametersChanged.compare_exchange_strong(expected, false))
         update();
 
+#if JX11_MIDI_STRESS
+    MidiStressMode stressMode = midiStressMode.load();
+    if (stressMode != MidiStressMode::off)
+    {
+        // Every run starts from the same seed so it can be repeated
+        if (stressMode != lastStressMode)
+            midiStress.reset();
+
+        // Merged while rendering, copying the host's events in here could
+        // outgrow the reserved size
+        stressMidi.clear();
+        midiStress.generate(stressMode, stressMidi, buffer.getNumSamples());
+        splitBufferByEevents(buffer, midiMessages, &stressMidi);
+    }
+    else
+    {
+        splitBufferByEevents(buffer, midiMessages);
+    }
+    lastStressMode = stressMode;
+#else
     splitBufferByEevents(buffer, midiMessages);
+#endif
+
+    if (telemetryEnabled.load())
+    {
+        if (!telemetryRunning)
+        {
+            telemetryCollector.reset();
+            telemetryRunning = true;
+        }
+
+        const float *right = (buffer.getNumChannels() > 1) ? buffer.getReadPointer(1) : nullptr;
+        telemetryCollector.process(buffer.getReadPointer(0), right, buffer.getNumSamples(), synth,
+                                   telemetryFifo);
+    }
+    else
+    {
+        telemetryRunning = false;
+    }
     // This is the place where you'd normally do the guts of your plugin's
     // audio processing...
     // Make sure to reset the state if your inner loop is processing
@@ -210,6 +436,18 @@ void JX11AudioProcessor::processBlock(juce::AudioBuffer<float> &buffer,
 
         // ..do something to the data...
     }
+
+    float load = loadMeter.record(startTicks, juce::Time::getHighResolutionTicks(),
+                                  buffer.getNumSamples(), getSampleRate());
+
+    // The new limits are applied at the start of the next block. Offline
+    // renders always use full quality.
+    if (!renderingOffline && governor.update(load))
+        parametersChanged.store(true);
+
+#if JX11_PROFILING
+    Profiler::endBlock();
+#endif
 }
 
 //==============================================================================
@@ -229,30 +467,141 @@ void JX11AudioProcessor::getStateInformation(juce::MemoryBlock &destData)
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-    copyXmlToBinary(*apvts.copyState().createXml(), destData);
+    juce::MemoryOutputStream stream(destData, false);
+    stream.writeInt(STATE_MAGIC);
+    stream.writeInt(STATE_VERSION);
+
+    stream.writeInt(int(stateParams.size()));
+    for (size_t i = 0; i < stateParams.size(); ++i)
+    {
+        const juce::RangedAudioParameter *param = stateParams[i];
+        stream.writeInt(int(stateParamHashes[i]));
+        stream.writeFloat(param->convertFrom0to1(param->getValue()));
+    }
+
+    stream.writeInt(Synth::MAX_PARTS - 1);
+    for (int p = 1; p < Synth::MAX_PARTS; ++p)
+    {
+        stream.writeInt(partProgram[p].load());
+    }
 }
 
 void JX11AudioProcessor::setStateInformation(const void *data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
-    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
-    if (xml.get() != nullptr && xml->hasTagName(apvts.state.getType()))
+    auto producer =
+        traceRecorder.producerFor(juce::MessageManager::existsAndIsCurrentThread());
+    ScopedTrace trace(traceRecorder, producer, TraceEvent::stateLoad, sizeInBytes);
+
+    // Sessions saved by older versions use XML
+    if (readBinaryState(data, sizeInBytes) || readXmlState(data, sizeInBytes))
     {
-        apvts.replaceState(juce::ValueTree::fromXml(*xml));
         parametersChanged.store(true);
     }
 }
 
+bool JX11AudioProcessor::readBinaryState(const void *data, int sizeInBytes)
+{
+    if (sizeInBytes < 12)
+        return false;
+
+    juce::MemoryInputStream stream(data, size_t(sizeInBytes), false);
+    if (stream.readInt() != STATE_MAGIC || stream.readInt() < 1)
+        return false;
+
+    int numValues = stream.readInt();
+    if (numValues < 0 || stream.getNumBytesRemaining() < juce::int64(numValues) * 8)
+        return false;
+
+    // Parameters that are not in the state go back to their defaults
+    std::vector<float> values(stateParams.size());
+    for (size_t i = 0; i < stateParams.size(); ++i)
+    {
+        values[i] = stateParams[i]->getDefaultValue();
+    }
+
+    for (int n = 0; n < numValues; ++n)
+    {
+        uint32_t hash = uint32_t(stream.readInt());
+        float value = stream.readFloat();
+
+        auto it = std::find(stateParamHashes.begin(), stateParamHashes.end(), hash);
+        if (it != stateParamHashes.end())
+        {
+            size_t i = size_t(it - stateParamHashes.begin());
+            values[i] = stateParams[i]->convertTo0to1(value);
+        }
+    }
+
+    for (size_t i = 0; i < stateParams.size(); ++i)
+    {
+        stateParams[i]->setValueNotifyingHost(values[i]);
+    }
+
+    int numPrograms = (stream.getNumBytesRemaining() >= 4) ? stream.readInt() : 0;
+    for (int i = 0; i < numPrograms && i + 1 < Synth::MAX_PARTS; ++i)
+    {
+        if (stream.getNumBytesRemaining() < 4)
+            break;
+        setPartProgram(i + 1, stream.readInt());
+    }
+    return true;
+}
+
+bool JX11AudioProcessor::readXmlState(const void *data, int sizeInBytes)
+{
+    std::unique_ptr<juce::XmlElement> xml(getXmlFromBinary(data, sizeInBytes));
+    if (xml.get() == nullptr || !xml->hasTagName(apvts.state.getType()))
+        return false;
+
+    apvts.replaceState(juce::ValueTree::fromXml(*xml));
+
+    juce::String programs = apvts.state.getProperty("partPrograms").toString();
+    juce::StringArray tokens = juce::StringArray::fromTokens(programs, false);
+    for (int i = 0; i < tokens.size() && i + 1 < Synth::MAX_PARTS; ++i)
+    {
+        setPartProgram(i + 1, tokens[i].getIntValue());
+    }
+    return true;
+}
+
 void JX11AudioProcessor::splitBufferByEevents(juce::AudioBuffer<float> &buffer,
-                                              juce::MidiBuffer &midiMessages)
+                                              juce::MidiBuffer &midiMessages,
+                                              const juce::MidiBuffer *generated)
 {
     int bufferOffset = 0;
+    const int quantize = noteQuantize.load();
+
+    auto hostEvent = midiMessages.cbegin();
+    auto hostEnd = midiMessages.cend();
+    auto generatedEvent = (generated != nullptr) ? generated->cbegin() : hostEnd;
+    auto generatedEnd = (generated != nullptr) ? generated->cend() : hostEnd;
 
-    for (const auto metadata : midiMessages)
+    while (hostEvent != hostEnd || generatedEvent != generatedEnd)
     {
-        // Render the audio that happens before this event (if any)
-        int samplesThisSegment = metadata.samplePosition - bufferOffset;
+        // The host's event goes first when both are at the same time
+        bool fromHost = generatedEvent == generatedEnd ||
+                        (hostEvent != hostEnd &&
+                         (*hostEvent).samplePosition <= (*generatedEvent).samplePosition);
+        const auto metadata = fromHost ? *hostEvent++ : *generatedEvent++;
+
+        // Render the audio that happens before this event (if any). Events at
+        // the same time as the previous one don't render anything.
+        int samplesThisSegment;
+        if (metadata.numBytes <= 3 &&
+            Synth::isControlRateEvent(metadata.data[0],
+                                      (metadata.numBytes >= 2) ? metadata.data[1] : 0))
+        {
+            // Only needs to be in place before the next control-rate update
+            samplesThisSegment =
+                synth.samplesBeforeControlEvent(metadata.samplePosition - bufferOffset);
+        }
+        else
+        {
+            int position = metadata.samplePosition - metadata.samplePosition % quantize;
+            samplesThisSegment = position - bufferOffset;
+        }
 
         if (samplesThisSegment > 0)
         {
@@ -263,6 +612,9 @@ void JX11AudioProcessor::splitBufferByEevents(juce::AudioBuffer<float> &buffer,
         // Handle the event. Ignore MIDI messages such as sysex
         if (metadata.numBytes <= 3)
         {
+            traceRecorder.instant(TraceRecorder::audioThread, TraceEvent::midiEvent,
+                                  metadata.data[0]);
+
             uint8_t data1 = (metadata.numBytes >= 2) ? metadata.data[1] : 0;
             uint8_t data2 = (metadata.numBytes == 3) ? metadata.data[2] : 0;
             handleMIDI(metadata.data[0], data1, data2);
@@ -282,13 +634,16 @@ void JX11AudioProcessor::splitBufferByEevents(juce::AudioBuffer<float> &buffer,
 
 void JX11AudioProcessor::render(juce::AudioBuffer<float> &buffer, int sampleCount, int bufferOffset)
 {
-    float *outputBuffers[2] = {nullptr, nullptr};
+    ScopedTrace trace(traceRecorder, TraceRecorder::audioThread, TraceEvent::render, sampleCount);
 
-    outputBuffers[0] = buffer.getWritePointer(0) + bufferOffset;
+    float *outputBuffers[2 * Synth::MAX_PARTS] = {nullptr};
 
-    if (getTotalNumOutputChannels() > 1)
+    for (int i = 0; i < 2 * synth.numBuses; ++i)
     {
-        outputBuffers[1] = buffer.getWritePointer(1) + bufferOffset;
+        if (outputChannel[i] >= 0)
+        {
+            outputBuffers[i] = buffer.getWritePointer(outputChannel[i]) + bufferOffset;
+        }
     }
 
     synth.render(outputBuffers, sampleCount);
@@ -313,8 +668,18 @@ void JX11AudioProcessor::handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2)
         }
 
     if ((data0 & 0xF0) == 0xC0)
-        if (data1 < presets.size())
-            setCurrentProgram(data1);
+        if (data1 < bank->size())
+        {
+            // In multi mode the other channels select the program of their part
+            int channel = data0 & 0x0F;
+            if (channel > 0 && channel < synth.getNumParts() && !synth.mpeEnabled)
+            {
+                midiPartProgram[channel] = data1;
+                parametersChanged.store(true);
+            }
+            else
+                setCurrentProgram(data1);
+        }
 
     synth.midiMesage(data0, data1, data2);
 }
@@ -344,6 +709,9 @@ juce::AudioProcessorValueTreeState::ParameterLayout JX11AudioProcessor::createPa
         juce::AudioParameterFloatAttributes().withLabel("%").withStringFromValueFunction(
             oscMixStringFromValue)));
 
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        ParameterID::notePriority, "Note Priority", juce::StringArray{"Last", "Low", "High"}, 0));
+
     layout.add(std::make_unique<juce::AudioParameterChoice>(
         ParameterID::glideMode, "Glide Mode", juce::StringArray{"Off", "Legato", "Always"}, 0));
 
@@ -431,6 +799,37 @@ juce::AudioProcessorValueTreeState::ParameterLayout JX11AudioProcessor::createPa
         juce::AudioParameterFloatAttributes().withLabel("Hz").withStringFromValueFunction(
             lfoRateStringFromValue)));
 
+    const juce::StringArray lfoShapes{"Sine", "Triangle", "Saw Up", "Saw Down", "Square", "S&H"};
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParameterID::lfoShape, "LFO Shape",
+                                                            lfoShapes, 0));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::lfo2Rate, "LFO 2 Rate", juce::NormalisableRange<float>(), 0.81f,
+        juce::AudioParameterFloatAttributes().withLabel("Hz").withStringFromValueFunction(
+            lfoRateStringFromValue)));
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(ParameterID::lfo2Shape, "LFO 2 Shape",
+                                                            lfoShapes, 0));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::lfo2Depth, "LFO 2 Depth", juce::NormalisableRange<float>(0.0f, 100.0f, 1.0f),
+        0.0f, juce::AudioParameterFloatAttributes().withLabel("%")));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::unison, "Unison", juce::NormalisableRange<float>(1.0f, 8.0f, 1.0f), 1.0f,
+        juce::AudioParameterFloatAttributes().withLabel("voices")));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::unisonDetune, "Unison Detune",
+        juce::NormalisableRange<float>(0.0f, 100.0f, 1.0f), 25.0f,
+        juce::AudioParameterFloatAttributes().withLabel("%")));
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        ParameterID::unisonSpread, "Unison Spread",
+        juce::NormalisableRange<float>(0.0f, 100.0f, 1.0f), 50.0f,
+        juce::AudioParameterFloatAttributes().withLabel("%")));
+
     auto vibratoStringFromValue = [](float value, int) {
         if (value < 0.0f)
             return "PWM " + juce::String(-value, 1);
@@ -460,104 +859,247 @@ juce::AudioProcessorValueTreeState::ParameterLayout JX11AudioProcessor::createPa
         juce::NormalisableRange<float>(-24.0f, 6.0f, 0.1f), 0.0f,
         juce::AudioParameterFloatAttributes().withLabel("dB")));
 
+    // Not part of the presets, this depends on the controller being used
+    layout.add(std::make_unique<juce::AudioParameterBool>(ParameterID::mpeMode, "MPE", false));
+
+    // Every MIDI channel plays its own part
+    layout.add(std::make_unique<juce::AudioParameterBool>(ParameterID::multiMode, "Multi", false));
+
     return layout;
 }
 
 void JX11AudioProcessor::update()
+{
+    ScopedTrace trace(traceRecorder, TraceRecorder::audioThread, TraceEvent::update, 0);
+
+    if (renderingOffline)
+    {
+        synth.lfoMax = offlineDecimation.load();
+    }
+    else
+    {
+        const QualityTier &limits = governor.getLimits();
+        synth.lfoMax = std::min(controlRateDecimation.load() * limits.lfoMaxFactor,
+                                Synth::MAX_LFO_MAX);
+    }
+    synth.audioRateModulation = audioRateModulation.load();
+    synth.oscillatorMode = oscillatorMode.load();
+    synth.mpeEnabled = mpeModeParam->get();
+    synth.setNumParts(multiModeParam->get() ? Synth::MAX_PARTS : 1);
+
+    float param[NUM_PARAMS];
+    for (int i = 0; i < NUM_PARAMS; ++i)
+    {
+        param[i] = presetParams[i]->convertFrom0to1(presetParams[i]->getValue());
+    }
+    updatePart(synth.parts[0], param);
+
+    const juce::SpinLock::ScopedTryLockType lock(partParamsLock);
+    if (lock.isLocked())
+    {
+        for (int p = 1; p < Synth::MAX_PARTS; ++p)
+        {
+            // MIDI can only select the programs that the bank keeps in memory
+            if (midiPartProgram[p] >= 0)
+            {
+                const Preset preset = bank->getPreset(midiPartProgram[p]);
+                std::copy(preset.param, preset.param + NUM_PARAMS, partParams[p].begin());
+                partProgram[p].store(midiPartProgram[p]);
+                midiPartProgram[p] = -1;
+            }
+        }
+
+        for (int p = 1; p < synth.getNumParts(); ++p)
+        {
+            updatePart(synth.parts[p], partParams[p].data());
+        }
+    }
+    else
+    {
+        parametersChanged.store(true);
+    }
+
+    updateOutputBuses();
+
+    synth.compileModulation();
+}
+
+void JX11AudioProcessor::updatePart(Part &part, const float *param)
 {
     float sampleRate = float(getSampleRate());
-    float semi = oscTuneParam->get();
-    float cent = oscFineParam->get();
-    float octave = octaveParam->get();
-    float tuning = tuningParam->get();
-    int polyMode = polyModeParam->getIndex();
-    float filterVelocity = filterVelocityParam->get();
-    float lfo = lfoRateParam->get();
-    float vibrato = vibratoParam->get() / 200.0f;
-    float filterFreq = filterFreqParam->get();
-    float filterReso = filterResoParam->get() / 100.0f;
-    float filterLFO = filterLFOParam->get() / 100.0f;
-    float filterSustain = filterSustainParam->get() / 100.0f;
-    float noiseMix = noiseParam->get() / 100.0f;
-    float envRelease = envReleaseParam->get();
+    float semi = param[PresetParam::oscTune];
+    float cent = param[PresetParam::oscFine];
+    float octave = param[PresetParam::octave];
+    float tuning = param[PresetParam::tuning];
+    int polyMode = int(param[PresetParam::polyMode]);
+    float filterVelocity = param[PresetParam::filterVelocity];
+    float lfo = param[PresetParam::lfoRate];
+    float vibrato = param[PresetParam::vibrato] / 200.0f;
+    float filterFreq = param[PresetParam::filterFreq];
+    float filterReso = param[PresetParam::filterReso] / 100.0f;
+    float filterLFO = param[PresetParam::filterLFO] / 100.0f;
+    float filterSustain = param[PresetParam::filterSustain] / 100.0f;
+    float noiseMix = param[PresetParam::noise] / 100.0f;
+    float envRelease = param[PresetParam::envRelease];
     float inverseSampleRate = 1.0f / sampleRate;
     float tuneInSemi = -36.3763f - 12.0f * octave - tuning / 100.0f;
-    const float inverseUpdateRate = inverseSampleRate * synth.LFO_MAX;
+    const float inverseUpdateRate = inverseSampleRate * float(synth.lfoMax);
     float lfoRate = std::exp(7.0f * lfo - 4.0f);
-    float glideRate = glideRateParam->get();
-
-    synth.filterKeytracking = 0.08f * filterFreq - 1.5f;
-    synth.filterQ = std::exp(3.0f * filterReso);
-    synth.filterLFODepth = 2.5f * filterLFO * filterLFO;
+    float lfo2Rate = std::exp(7.0f * param[PresetParam::lfo2Rate] - 4.0f);
+    float lfo2Depth = param[PresetParam::lfo2Depth] / 100.0f;
+    float glideRate = param[PresetParam::glideRate];
+    int unison = int(param[PresetParam::unison]);
+    float unisonDetune = param[PresetParam::unisonDetune] / 100.0f;
+
+    part.filterKeytracking = 0.08f * filterFreq - 1.5f;
+    part.filterQ = std::exp(3.0f * filterReso);
+    part.filterLFODepth = 2.5f * filterLFO * filterLFO;
     if (filterVelocity < -90.0f)
     {
-        synth.velocitySensitivity = 0.0f;
-        synth.ignoreVelocity = true;
+        part.velocitySensitivity = 0.0f;
+        part.ignoreVelocity = true;
     }
     else
     {
-        synth.velocitySensitivity = 0.0005f * filterVelocity;
-        synth.ignoreVelocity = false;
+        part.velocitySensitivity = 0.0005f * filterVelocity;
+        part.ignoreVelocity = false;
+    }
+    part.vibrato = 0.2f * vibrato * vibrato;
+    const QualityTier &limits =
+        renderingOffline ? QualityGovernor::tiers[0] : governor.getLimits();
+    part.numVoices = (polyMode == 0) ? 1 : std::min(Synth::MAX_POLYPHONY, limits.maxPolyphony);
+    part.lfoInc = lfoRate * inverseUpdateRate;
+    part.lfoShape = LFOShape(int(param[PresetParam::lfoShape]));
+    part.lfo2Inc = lfo2Rate * inverseUpdateRate;
+    part.lfo2Shape = LFOShape(int(param[PresetParam::lfo2Shape]));
+    part.lfo2Depth = 2.5f * lfo2Depth * lfo2Depth;
+    part.tune = sampleRate * std::exp(0.05776226505f * tuneInSemi);
+    part.detune = std::pow(1.059463094359f, -semi - 0.01f * cent);
+    part.pwmDepth = part.vibrato;
+    part.glideMode = int(param[PresetParam::glideMode]);
+    part.notePriority = NotePriority(int(param[PresetParam::notePriority]));
+    part.glideBend = param[PresetParam::glideBend];
+
+    // Each outer oscillator of the stack is up to a semitone from the
+    // note, so the two are up to two semitones apart
+    part.numUnison = std::clamp(unison, 1, std::min(Voice::MAX_UNISON, limits.maxUnison));
+    part.unisonSpread = param[PresetParam::unisonSpread] / 100.0f;
+    part.unisonGain = 1.0f / std::sqrt(float(part.numUnison));
+    part.unisonLowest = 1.0f;
+
+    int last = part.numUnison - 1;
+    for (int i = 0; i < Voice::MAX_UNISON; ++i)
+    {
+        float offset = 0.0f;
+        if (last > 0)
+            offset = 2.0f * float(std::min(i, last)) / float(last) - 1.0f;
+
+        part.unisonDetune[i] = std::pow(1.059463094359f, -unisonDetune * unisonDetune * offset);
+        part.unisonLowest = std::min(part.unisonLowest, part.unisonDetune[i]);
     }
-    synth.vibrato = 0.2f * vibrato * vibrato;
-    synth.numVoices = (polyMode == 0) ? 1 : Synth::MAX_VOICES;
-    synth.lfoInc = lfoRate * inverseUpdateRate * float(TAU);
-    synth.tune = sampleRate * std::exp(0.05776226505f * tuneInSemi);
-    synth.detune = std::pow(1.059463094359f, -semi - 0.01f * cent);
-    synth.pwmDepth = synth.vibrato;
-    synth.glideMode = glideModeParam->getIndex();
-    synth.glideBend = glideBendParam->get();
 
     if (glideRate < 2.0f)
     {
-        synth.glideRate = 1.0f;
+        part.glideRate = 1.0f;
     }
     else
     {
         auto exp = std::exp(-inverseUpdateRate * std::exp(6.0f - 0.07f * glideRate));
-        synth.glideRate = 1.0f - exp;
+        part.glideRate = 1.0f - exp;
     }
     if (vibrato < 0.0f)
-        synth.vibrato = 0.0f;
+        part.vibrato = 0.0f;
 
-    synth.filterAttack =
-        std::exp(-inverseUpdateRate * std::exp(5.5f - 0.075f * filterAttackParam->get()));
-    synth.filterDecay =
-        std::exp(-inverseUpdateRate * std::exp(5.5f - 0.075f * filterDecayParam->get()));
-    synth.filterSustain = filterSustain * filterSustain;
-    synth.filterRelease =
-        std::exp(-inverseUpdateRate * std::exp(5.5f - 0.075f * filterReleaseParam->get()));
-    synth.filterEnvDepth = 0.06f * filterEnvParam->get();
+    part.filterAttack =
+        std::exp(-inverseUpdateRate * std::exp(5.5f - 0.075f * param[PresetParam::filterAttack]));
+    part.filterDecay =
+        std::exp(-inverseUpdateRate * std::exp(5.5f - 0.075f * param[PresetParam::filterDecay]));
+    part.filterSustain = filterSustain * filterSustain;
+    part.filterRelease =
+        std::exp(-inverseUpdateRate * std::exp(5.5f - 0.075f * param[PresetParam::filterRelease]));
+    part.filterEnvDepth = 0.06f * param[PresetParam::filterEnv];
 
-    synth.envAttack =
-        std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envAttackParam->get()));
+    part.envAttack =
+        std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * param[PresetParam::envAttack]));
 
-    synth.envDecay = std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envDecayParam->get()));
+    part.envDecay =
+        std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * param[PresetParam::envDecay]));
 
-    synth.envSustain = envSustainParam->get() / 100.0f;
+    part.envSustain = param[PresetParam::envSustain] / 100.0f;
 
     if (envRelease < 1.0f)
     {
-        synth.envRelease = 0.75f; // extra fast release
+        part.envRelease = 0.75f; // extra fast release
     }
     else
     {
-        synth.envRelease = std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envRelease));
+        part.envRelease = std::exp(-inverseSampleRate * std::exp(5.5f - 0.075f * envRelease));
     }
     noiseMix *= noiseMix;
 
-    synth.oscMix = oscMixParam->get() / 100.0f;
+    part.oscMix = param[PresetParam::oscMix] / 100.0f;
+
+    part.noiseMix = noiseMix * 0.06f;
+    part.volumeTrim =
+        0.0008f * (3.2f - part.oscMix - 25.0f * part.noiseMix) * (1.5f - 0.5f * filterReso);
 
-    synth.noiseMix = noiseMix * 0.06f;
-    synth.volumeTrim =
-        0.0008f * (3.2f - synth.oscMix - 25.0f * synth.noiseMix) * (1.5f - 0.5f * filterReso);
+    float targetOutputLevel = juce::Decibels::decibelsToGain(param[PresetParam::outputLevel]);
+    part.outputLevelSmoother.setTargetValue(targetOutputLevel);
+}
 
-    float targetOutputLevel = juce::Decibels::decibelsToGain(outputLevelParam->get());
-    synth.outputLevelSmoother.setTargetValue(targetOutputLevel);
+void JX11AudioProcessor::updateOutputBuses()
+{
+    // Bus 0 of the synth is the main output, the parts that have their own
+    // output enabled get the next buses in order
+    outputChannel.fill(-1);
+    synth.partBus.fill(0);
+    synth.numBuses = 0;
+
+    for (int p = 0; p < synth.getNumParts(); ++p)
+    {
+        if (p > 0 && (p >= getBusCount(false) || !getBus(false, p)->isEnabled()))
+            continue;
+
+        int b = synth.numBuses++;
+        synth.partBus[p] = b;
+
+        if (p < getBusCount(false))
+        {
+            int numChannels = getBus(false, p)->getNumberOfChannels();
+            for (int ch = 0; ch < std::min(numChannels, 2); ++ch)
+            {
+                outputChannel[2 * b + ch] = getChannelIndexInProcessBlockBuffer(false, p, ch);
+            }
+        }
+    }
 }
 
-void JX11AudioProcessor::createPrograms()
+juce::File JX11AudioProcessor::presetBankFile()
 {
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("JX11")
+        .getChildFile("Presets.jx11bank");
+}
+
+bool JX11AudioProcessor::exportPresetBank(const juce::File &file) const
+{
+    return PresetBank::write(file, bank->getBuiltIn(), presetParamHashes());
+}
+
+PresetBank::ParamHashes JX11AudioProcessor::presetParamHashes() const
+{
+    PresetBank::ParamHashes hashes;
+    for (int i = 0; i < NUM_PARAMS; ++i)
+    {
+        hashes[i] = hashString(presetParams[i]->paramID.toRawUTF8());
+    }
+    return hashes;
+}
+
+std::vector<Preset> JX11AudioProcessor::createPrograms()
+{
+    std::vector<Preset> presets;
+
     presets.emplace_back("Init", 0.00f, -12.00f, 0.00f, 0.00f, 35.00f, 0.00f, 100.00f, 15.00f,
                          50.00f, 0.00f, 0.00f, 0.00f, 30.00f, 0.00f, 25.00f, 0.00f, 50.00f, 100.00f,
                          30.00f, 0.81f, 0.00f, 0.00f, 0.00f, 0.00f, 0.00f, 1.00f);
@@ -727,6 +1269,8 @@ void JX11AudioProcessor::createPrograms()
     presets.emplace_back("Squelchy Frog", 50.00f, -5.00f, -7.90f, 2.00f, 77.00f, -36.00f, 40.00f,
                          65.00f, 90.00f, 0.00f, 0.00f, 33.00f, 50.00f, 0.00f, 25.00f, 0.00f, 70.00f,
                          65.00f, 18.00f, 0.32f, 100.00f, 0.00f, -2.00f, 0.00f, 0.00f, 1.00f);
+
+    return presets;
 }
 
 //==============================================================================
@@ -12,6 +12,13 @@
 
 #include "Synth.h"
 #include "Preset.h"
+#include "PresetBank.h"
+#include "SharedTables.h"
+#include "Telemetry.h"
+#include "LoadMeter.h"
+#include "TraceRecorder.h"
+#include "MidiStress.h"
+#include "QualityGovernor.h"
 
 namespace ParameterID
 {
@@ -43,6 +50,16 @@ PARAMETER_ID(octave)
 PARAMETER_ID(tuning)
 PARAMETER_ID(outputLevel)
 PARAMETER_ID(polyMode)
+PARAMETER_ID(lfoShape)
+PARAMETER_ID(lfo2Rate)
+PARAMETER_ID(lfo2Shape)
+PARAMETER_ID(lfo2Depth)
+PARAMETER_ID(unison)
+PARAMETER_ID(unisonDetune)
+PARAMETER_ID(unisonSpread)
+PARAMETER_ID(notePriority)
+PARAMETER_ID(mpeMode)
+PARAMETER_ID(multiMode)
 
 #undef PARAMETER_ID
 } // namespace ParameterID
@@ -98,14 +115,145 @@ class JX11AudioProcessor : public juce::AudioProcessor,
     void getStateInformation(juce::MemoryBlock &destData) override;
     void setStateInformation(const void *data, int sizeInBytes) override;
 
+    // Number of samples between control-rate updates, trades modulation
+    // resolution against CPU. Takes effect at the start of the next block.
+    void setControlRateDecimation(int samples);
+    int getControlRateDecimation() const { return controlRateDecimation.load(); }
+
+    // Used instead of the above while the host renders offline, when there is
+    // no deadline to meet. The default of 1 updates modulation every sample.
+    void setOfflineControlRateDecimation(int samples);
+    int getOfflineControlRateDecimation() const { return offlineDecimation.load(); }
+
+    // Smooths fast filter envelopes and glides by interpolating cutoff and
+    // pitch on every sample between the control-rate updates
+    void setAudioRateModulation(bool enabled);
+    bool getAudioRateModulation() const { return audioRateModulation.load(); }
+
+    // Switches new notes between the band-limited impulse train oscillators
+    // and fixed-point phase oscillators reading band-limited saw tables
+    void setOscillatorMode(OscillatorMode mode);
+    OscillatorMode getOscillatorMode() const { return oscillatorMode.load(); }
+
+    // The editor turns this on while it is open, the audio thread doesn't
+    // collect anything otherwise. Frames left over from the last time the
+    // editor was open are dropped.
+    void setTelemetryEnabled(bool enabled)
+    {
+        if (enabled)
+            telemetryFifo.clear();
+        telemetryEnabled.store(enabled);
+    }
+    bool readTelemetry(TelemetryFrame &frame) { return telemetryFifo.pop(frame); }
+
+    // Time spent in processBlock as a fraction of the block's duration
+    LoadStats getLoadStats() const { return loadMeter.getStats(); }
+    void setLoadThreshold(int index, float load) { loadMeter.setThreshold(index, load); }
+    void resetLoadStats() { loadMeter.reset(); }
+
+    // Lowers the control rate, unison and polyphony when the audio thread is
+    // close to its deadline. Off unless the user turns it on in the editor.
+    // getQualityTier() is 0 at full quality.
+    void setQualityGovernorEnabled(bool enabled) { governor.setEnabled(enabled); }
+    bool isQualityGovernorEnabled() const { return governor.isEnabled(); }
+    int getQualityTier() const { return governor.getTier(); }
+
+    // Writes a Chrome trace of the audio thread's activity to file until
+    // stopTrace() is called. Setting the JX11_TRACE environment variable to a
+    // file name starts a trace when the plugin is created.
+    bool startTrace(const juce::File &file) { return traceRecorder.start(file); }
+    void stopTrace() { traceRecorder.stop(); }
+
+#if JX11_MIDI_STRESS
+    // Adds generated MIDI to every block to measure the worst-case block time
+    // with getLoadStats(). Setting the JX11_MIDI_STRESS environment variable
+    // to dense, random or adversarial turns this on when the plugin is created.
+    void setMidiStress(MidiStressMode mode) { midiStressMode.store(mode); }
+    MidiStressMode getMidiStress() const { return midiStressMode.load(); }
+#endif
+
+    // Number of blocks in which the output had to be silenced or clamped
+    const ProtectionStats &getProtectionStats() const { return synth.protectionStats; }
+
+    // Moves note events back to a multiple of this many samples from the
+    // start of the block, so that chords and fast runs split the render into
+    // fewer segments. 1 plays every note at its exact time.
+    void setNoteQuantize(int samples) { noteQuantize.store(juce::jlimit(1, 64, samples)); }
+    int getNoteQuantize() const { return noteQuantize.load(); }
+
+    // A bank file here is loaded instead of the built-in presets when the
+    // plugin is created
+    static juce::File presetBankFile();
+
+    // Writes the built-in presets as a bank file, as a starting point for a
+    // library
+    bool exportPresetBank(const juce::File &file) const;
+
+    // The preset played by each part in multi mode. Part 1 always plays the
+    // current program, so that its parameters can be automated.
+    void setPartProgram(int part, int index);
+    int getPartProgram(int part) const { return partProgram[part].load(); }
+
+    // Number of voices the part plays. Reads the audio thread's state, so
+    // only call it between blocks.
+    int getNumActiveVoices(int part) const { return synth.getNumActiveVoices(part); }
+
   private:
     //==============================================================================
+    static BusesProperties createBusesProperties();
+
     Synth synth;
 
     std::atomic<bool> parametersChanged{false};
-    std::vector<Preset> presets;
+    std::atomic<int> controlRateDecimation{Synth::DEFAULT_LFO_MAX};
+    std::atomic<int> offlineDecimation{Synth::MIN_LFO_MAX};
+    bool renderingOffline = false;
+    std::atomic<bool> audioRateModulation{false};
+    std::atomic<OscillatorMode> oscillatorMode{OscillatorMode::blit};
+    std::atomic<int> noteQuantize{1};
+
+    std::atomic<bool> telemetryEnabled{false};
+    bool telemetryRunning = false;
+    TelemetryFifo telemetryFifo;
+    TelemetryCollector telemetryCollector;
+
+    LoadMeter loadMeter;
+    QualityGovernor governor;
+    TraceRecorder traceRecorder;
+
+#if JX11_MIDI_STRESS
+    std::atomic<MidiStressMode> midiStressMode{MidiStressMode::off};
+    MidiStressMode lastStressMode = MidiStressMode::off;
+    MidiStress midiStress;
+    juce::MidiBuffer stressMidi; // only the generated events
+#endif
+
+    std::shared_ptr<const PresetBank> bank; // shared by all instances
     int currentProgram;
 
+    std::array<std::atomic<int>, Synth::MAX_PARTS> partProgram;
+
+    // Parameter values of each part's program. setPartProgram() copies them
+    // out of the bank on the message thread, the audio thread only try-locks
+    // and uses them on the next block if it can't get the lock.
+    juce::SpinLock partParamsLock;
+    std::array<std::array<float, NUM_PARAMS>, Synth::MAX_PARTS> partParams;
+
+    // MIDI program changes of the parts, applied by update(). -1 for none.
+    // Audio thread only.
+    std::array<int, Synth::MAX_PARTS> midiPartProgram;
+
+    // Channels in the process buffer that each of the synth's output buses
+    // write to, -1 for none
+    std::array<int, 2 * Synth::MAX_PARTS> outputChannel;
+
+    // Every parameter with the hash of its ID, for the binary state
+    std::vector<juce::RangedAudioParameter *> stateParams;
+    std::vector<uint32_t> stateParamHashes;
+
+    // The parameters that are stored in a preset, in the same order
+    std::array<juce::RangedAudioParameter *, NUM_PARAMS> presetParams;
+
     juce::AudioParameterFloat *oscMixParam;
     juce::AudioParameterFloat *oscTuneParam;
     juce::AudioParameterFloat *oscFineParam;
@@ -132,12 +280,30 @@ class JX11AudioProcessor : public juce::AudioProcessor,
     juce::AudioParameterFloat *tuningParam;
     juce::AudioParameterFloat *outputLevelParam;
     juce::AudioParameterChoice *polyModeParam;
+    juce::AudioParameterChoice *lfoShapeParam;
+    juce::AudioParameterFloat *lfo2RateParam;
+    juce::AudioParameterChoice *lfo2ShapeParam;
+    juce::AudioParameterFloat *lfo2DepthParam;
+    juce::AudioParameterFloat *unisonParam;
+    juce::AudioParameterFloat *unisonDetuneParam;
+    juce::AudioParameterFloat *unisonSpreadParam;
+    juce::AudioParameterChoice *notePriorityParam;
+    juce::AudioParameterBool *mpeModeParam;
+    juce::AudioParameterBool *multiModeParam;
 
-    void splitBufferByEevents(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages);
+    // generated holds extra events that are played together with the host's,
+    // in time order
+    void splitBufferByEevents(juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages,
+                              const juce::MidiBuffer *generated = nullptr);
     void handleMIDI(uint8_t data0, uint8_t data1, uint8_t data2);
     void render(juce::AudioBuffer<float> &buffer, int sampleCount, int bufferOffset);
     void update();
-    void createPrograms();
+    void updatePart(Part &part, const float *param);
+    void updateOutputBuses();
+    bool readBinaryState(const void *data, int sizeInBytes);
+    bool readXmlState(const void *data, int sizeInBytes);
+    static std::vector<Preset> createPrograms();
+    PresetBank::ParamHashes presetParamHashes() const;
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
     void valueTreePropertyChanged(juce::ValueTree &, const juce::Identifier &) override
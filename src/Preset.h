@@ -12,14 +12,58 @@
 
 #include <cstring>
 
-const int NUM_PARAMS = 26;
+const int NUM_PARAMS = 34;
+
+// Index of each parameter in Preset::param
+namespace PresetParam
+{
+enum
+{
+    oscMix,
+    oscTune,
+    oscFine,
+    glideMode,
+    glideRate,
+    glideBend,
+    filterFreq,
+    filterReso,
+    filterEnv,
+    filterLFO,
+    filterVelocity,
+    filterAttack,
+    filterDecay,
+    filterSustain,
+    filterRelease,
+    envAttack,
+    envDecay,
+    envSustain,
+    envRelease,
+    lfoRate,
+    vibrato,
+    noise,
+    octave,
+    tuning,
+    outputLevel,
+    polyMode,
+    lfoShape,
+    lfo2Rate,
+    lfo2Shape,
+    lfo2Depth,
+    unison,
+    unisonDetune,
+    unisonSpread,
+    notePriority,
+};
+} // namespace PresetParam
 
 struct Preset
 {
     Preset(const char *name, float p0, float p1, float p2, float p3, float p4, float p5, float p6,
            float p7, float p8, float p9, float p10, float p11, float p12, float p13, float p14,
            float p15, float p16, float p17, float p18, float p19, float p20, float p21, float p22,
-           float p23, float p24, float p25)
+           float p23, float p24, float p25, float p26 = 0.0f, float p27 = 0.81f,
+           float p28 = 0.0f, float p29 = 0.0f, float p30 = 1.0f, float p31 = 25.0f,
+           float p32 = 50.0f, float p33 = 0.0f)
     {
         strcpy(this->name, name);
         param[0] = p0;   // Osc Mix
@@ -48,6 +92,14 @@ struct Preset
         param[23] = p23; // Tuning
         param[24] = p24; // Output Level
         param[25] = p25; // Polyphony
+        param[26] = p26; // LFO Shape
+        param[27] = p27; // LFO 2 Rate
+        param[28] = p28; // LFO 2 Shape
+        param[29] = p29; // LFO 2 Depth
+        param[30] = p30; // Unison
+        param[31] = p31; // Unison Detune
+        param[32] = p32; // Unison Spread
+        param[33] = p33; // Note Priority
     }
 
     char name[40];
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+    Created: 20 Oct 2026 4:02:51pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+#include "Utils.h"
+
+PresetBank::PresetBank(std::vector<Preset> builtIn_) : builtIn(std::move(builtIn_))
+{
+    paramColumn.fill(-1);
+}
+
+bool PresetBank::open(const juce::File &file, const ParamHashes &paramHashes)
+{
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+    const char *data = static_cast<const char *>(mapped->getData());
+    size_t size = mapped->getSize();
+    if (data == nullptr || size < sizeof(Header))
+        return false;
+
+    const Header *h = reinterpret_cast<const Header *>(data);
+    if (h->magic != MAGIC || h->version < 1 || h->numPresets == 0)
+        return false;
+
+    // Everything the header points at must be inside the file
+    uint64_t numPresets = h->numPresets;
+    if (h->recordSize < NAME_SIZE + 4 * uint64_t(h->numColumns) ||
+        h->columnsOffset + 4 * uint64_t(h->numColumns) > size ||
+        h->indexOffset + sizeof(IndexEntry) * numPresets > size ||
+        h->recordsOffset + uint64_t(h->recordSize) * numPresets > size ||
+        h->columnsOffset % 4 != 0 || h->indexOffset % 4 != 0 || h->recordsOffset % 4 != 0 ||
+        h->recordSize % 4 != 0)
+    {
+        return false;
+    }
+
+    const uint32_t *columns = reinterpret_cast<const uint32_t *>(data + h->columnsOffset);
+    for (int i = 0; i < NUM_PARAMS; ++i)
+    {
+        paramColumn[i] = -1;
+        for (uint32_t c = 0; c < h->numColumns; ++c)
+        {
+            if (columns[c] == paramHashes[i])
+                paramColumn[i] = int(c);
+        }
+    }
+
+    mappedFile = std::move(mapped);
+    header = h;
+    nameIndex = reinterpret_cast<const IndexEntry *>(data + h->indexOffset);
+    records = data + h->recordsOffset;
+
+    resident.clear();
+    int numResident = int(std::min(numPresets, uint64_t(NUM_RESIDENT)));
+    resident.reserve(size_t(numResident));
+    for (int i = 0; i < numResident; ++i)
+    {
+        resident.push_back(readPreset(i));
+    }
+    return true;
+}
+
+int PresetBank::size() const
+{
+    return isOpen() ? int(header->numPresets) : int(builtIn.size());
+}
+
+juce::String PresetBank::getName(int index) const
+{
+    if (!isOpen())
+        return {builtIn[index].name};
+
+    // The name may fill all 40 bytes without a terminator
+    const char *name = record(index);
+    return juce::String(name, size_t(strnlen(name, NAME_SIZE)));
+}
+
+Preset PresetBank::getPreset(int index) const
+{
+    if (!isOpen())
+        return builtIn[index];
+
+    if (index < int(resident.size()))
+        return resident[size_t(index)];
+
+    return readPreset(index);
+}
+
+Preset PresetBank::readPreset(int index) const
+{
+    const char *rec = record(index);
+
+    Preset preset = builtIn[0];
+    std::memcpy(preset.name, rec, NAME_SIZE);
+    preset.name[NAME_SIZE - 1] = 0;
+
+    const float *values = reinterpret_cast<const float *>(rec + NAME_SIZE);
+    for (int i = 0; i < NUM_PARAMS; ++i)
+    {
+        if (paramColumn[i] >= 0)
+            preset.param[i] = values[paramColumn[i]];
+    }
+    return preset;
+}
+
+int PresetBank::find(const juce::String &name) const
+{
+    const char *utf8 = name.toRawUTF8();
+
+    if (!isOpen())
+    {
+        for (size_t i = 0; i < builtIn.size(); ++i)
+        {
+            if (std::strncmp(builtIn[i].name, utf8, NAME_SIZE) == 0)
+                return int(i);
+        }
+        return -1;
+    }
+
+    uint32_t hash = hashString(utf8, NAME_SIZE);
+    const IndexEntry *end = nameIndex + header->numPresets;
+    const IndexEntry *entry = std::lower_bound(
+        nameIndex, end, hash, [](const IndexEntry &e, uint32_t h) { return e.nameHash < h; });
+
+    // Different names can share a hash
+    for (; entry != end && entry->nameHash == hash; ++entry)
+    {
+        if (entry->program < header->numPresets &&
+            std::strncmp(record(int(entry->program)), utf8, NAME_SIZE) == 0)
+        {
+            return int(entry->program);
+        }
+    }
+    return -1;
+}
+
+bool PresetBank::write(const juce::File &file, const std::vector<Preset> &presets,
+                       const ParamHashes &paramHashes)
+{
+    const uint32_t numPresets = uint32_t(presets.size());
+    const uint32_t columnsOffset = sizeof(Header);
+    const uint32_t indexOffset = columnsOffset + 4 * NUM_PARAMS;
+    const uint32_t recordsOffset = indexOffset + uint32_t(sizeof(IndexEntry)) * numPresets;
+
+    std::vector<IndexEntry> index(numPresets);
+    for (uint32_t i = 0; i < numPresets; ++i)
+    {
+        index[i] = {hashString(presets[i].name, NAME_SIZE), i};
+    }
+    std::sort(index.begin(), index.end(), [](const IndexEntry &a, const IndexEntry &b) {
+        return a.nameHash < b.nameHash;
+    });
+
+    juce::FileOutputStream stream(file);
+    if (stream.failedToOpen())
+        return false;
+
+    stream.setPosition(0);
+    stream.truncate();
+
+    stream.writeInt(int(MAGIC));
+    stream.writeInt(int(VERSION));
+    stream.writeInt(int(numPresets));
+    stream.writeInt(NUM_PARAMS);
+    stream.writeInt(NAME_SIZE + 4 * NUM_PARAMS);
+    stream.writeInt(int(columnsOffset));
+    stream.writeInt(int(indexOffset));
+    stream.writeInt(int(recordsOffset));
+
+    for (uint32_t hash : paramHashes)
+        stream.writeInt(int(hash));
+
+    for (const IndexEntry &entry : index)
+    {
+        stream.writeInt(int(entry.nameHash));
+        stream.writeInt(int(entry.program));
+    }
+
+    for (const Preset &preset : presets)
+    {
+        char name[NAME_SIZE] = {};
+        std::strncpy(name, preset.name, NAME_SIZE - 1);
+        stream.write(name, NAME_SIZE);
+
+        for (float value : preset.param)
+            stream.writeFloat(value);
+    }
+
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+    Created: 20 Oct 2026 4:02:51pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+#include "Preset.h"
+
+/*
+ The programs of the plugin: either the built-in presets, or a bank file that
+ is memory-mapped so that a library of thousands of patches costs nothing
+ until a program is actually used.
+
+ The first programs, the ones that a MIDI program change can select, are
+ copied into memory when the bank is opened. getPreset() on the audio thread
+ then never touches the mapped file, where a cold page would be a page fault.
+
+ A bank file is little-endian and laid out as:
+   header
+   FNV-1a hash of the parameter ID of every column
+   name index: (hash of the name, program number), sorted by hash
+   one fixed-size record per program: 40 bytes of name, then a float for
+   every column
+
+ Columns are matched to the parameters by ID when the bank is opened, so a
+ bank keeps working when parameters are added or reordered. Parameters that
+ the bank doesn't have take their value from the Init preset.
+ */
+class PresetBank
+{
+  public:
+    static constexpr uint32_t MAGIC = 0x4231584A; // "JX1B"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr int NAME_SIZE = 40;
+    static constexpr int NUM_RESIDENT = 128;
+
+    // Hash of the parameter ID that goes with each Preset::param
+    using ParamHashes = std::array<uint32_t, NUM_PARAMS>;
+
+    explicit PresetBank(std::vector<Preset> builtIn);
+
+    // Replaces the built-in presets with a bank file. Call this before audio
+    // starts. Returns false, and keeps the current programs, if the file is
+    // missing or not a valid bank.
+    bool open(const juce::File &file, const ParamHashes &paramHashes);
+    bool isOpen() const { return header != nullptr; }
+
+    const std::vector<Preset> &getBuiltIn() const { return builtIn; }
+
+    int size() const;
+    juce::String getName(int index) const;
+
+    // Safe on the audio thread for index < NUM_RESIDENT
+    Preset getPreset(int index) const;
+
+    // Program number of the preset with this name, or -1
+    int find(const juce::String &name) const;
+
+    static bool write(const juce::File &file, const std::vector<Preset> &presets,
+                      const ParamHashes &paramHashes);
+
+  private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t numPresets;
+        uint32_t numColumns;
+        uint32_t recordSize;
+        uint32_t columnsOffset;
+        uint32_t indexOffset;
+        uint32_t recordsOffset;
+    };
+
+    struct IndexEntry
+    {
+        uint32_t nameHash;
+        uint32_t program;
+    };
+
+    const char *record(int index) const
+    {
+        return records + size_t(index) * size_t(header->recordSize);
+    }
+
+    Preset readPreset(int index) const;
+
+    std::vector<Preset> builtIn;
+    std::vector<Preset> resident; // the first NUM_RESIDENT programs of the file
+
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    const Header *header = nullptr;
+    const IndexEntry *nameIndex = nullptr;
+    const char *records = nullptr;
+
+    // Column in the bank of each Preset::param, -1 if the bank doesn't have it
+    std::array<int, NUM_PARAMS> paramColumn;
+
+    JUCE_DECLARE_NON_COPYABLE(PresetBank)
+};
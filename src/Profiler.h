@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    Profiler.h
+    Created: 20 Oct 2026 11:08:50am
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/*
+ Scoped probes that count CPU cycles (timer ticks on ARM) spent in each
+ stage of the DSP chain.
+ They only exist when the plugin is built with the JX11_PROFILING CMake
+ option, otherwise JX11_PROBE expands to nothing.
+
+ A probe adds to counters owned by the thread it runs on, so the audio thread
+ never shares a cache line with anything. At the end of every block these
+ are folded into the totals that report() reads.
+ */
+
+#ifndef JX11_PROFILING
+#define JX11_PROFILING 0
+#endif
+
+#if JX11_PROFILING
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <x86intrin.h>
+#endif
+
+namespace Profiler
+{
+enum Stage
+{
+    oscillators,
+    filter,
+    envelope,
+    updateLFO,
+    protectYourEars,
+    NUM_STAGES,
+};
+
+inline const char *stageName(int stage)
+{
+    static const char *names[NUM_STAGES] = {
+        "Oscillators", "Filter", "Envelope", "Synth::updateLFO", "protectYourEars",
+    };
+    return names[stage];
+}
+
+// The unit of the counter. On ARM the virtual timer runs at a fixed
+// frequency, usually well below the CPU clock, so its ticks aren't cycles.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+inline constexpr const char *counterUnit = "cycles";
+#elif defined(__aarch64__)
+inline constexpr const char *counterUnit = "ticks";
+#else
+inline constexpr const char *counterUnit = "clock ticks";
+#endif
+
+inline uint64_t readCycleCounter()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct Counters
+{
+    std::array<uint64_t, NUM_STAGES> cycles{};
+    std::array<uint64_t, NUM_STAGES> calls{};
+};
+
+// The current block on this thread
+inline thread_local Counters blockCounters;
+
+// Totals since the last reset, written by the audio thread in endBlock()
+inline std::array<std::atomic<uint64_t>, NUM_STAGES> totalCycles;
+inline std::array<std::atomic<uint64_t>, NUM_STAGES> totalCalls;
+inline std::atomic<uint64_t> totalBlocks;
+
+class ScopedProbe
+{
+  public:
+    explicit ScopedProbe(Stage s) : stage(s), start(readCycleCounter()) {}
+
+    ~ScopedProbe()
+    {
+        blockCounters.cycles[stage] += readCycleCounter() - start;
+        blockCounters.calls[stage] += 1;
+    }
+
+  private:
+    Stage stage;
+    uint64_t start;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedProbe)
+};
+
+inline void endBlock()
+{
+    for (int i = 0; i < NUM_STAGES; ++i)
+    {
+        totalCycles[i].fetch_add(blockCounters.cycles[i], std::memory_order_relaxed);
+        totalCalls[i].fetch_add(blockCounters.calls[i], std::memory_order_relaxed);
+    }
+    totalBlocks.fetch_add(1, std::memory_order_relaxed);
+    blockCounters = {};
+}
+
+inline void reset()
+{
+    for (int i = 0; i < NUM_STAGES; ++i)
+    {
+        totalCycles[i].store(0, std::memory_order_relaxed);
+        totalCalls[i].store(0, std::memory_order_relaxed);
+    }
+    totalBlocks.store(0, std::memory_order_relaxed);
+}
+
+// One line per stage with its average count per block and per call, in
+// counterUnit
+inline juce::String report()
+{
+    uint64_t blocks = std::max(totalBlocks.load(std::memory_order_relaxed), uint64_t(1));
+
+    juce::String text = "JX11 profile over " + juce::String(juce::int64(blocks)) + " blocks\n";
+    for (int i = 0; i < NUM_STAGES; ++i)
+    {
+        uint64_t cycles = totalCycles[i].load(std::memory_order_relaxed);
+        uint64_t calls = std::max(totalCalls[i].load(std::memory_order_relaxed), uint64_t(1));
+
+        text += juce::String(stageName(i)).paddedRight(' ', 20) +
+                juce::String(juce::int64(cycles / blocks)) + " " + counterUnit + "/block, " +
+                juce::String(double(cycles) / double(calls), 1) + " " + counterUnit + "/call\n";
+    }
+    return text;
+}
+} // namespace Profiler
+
+#define JX11_PROBE(stage) Profiler::ScopedProbe JUCE_JOIN_MACRO(probe, __LINE__)(Profiler::stage)
+
+#else
+
+#define JX11_PROBE(stage)
+
+#endif
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+    Created: 20 Oct 2026 7:12:33pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// What the engine may spend at a given tier. Tier 0 is full quality.
+struct QualityTier
+{
+    int lfoMaxFactor; // multiplies the control-rate decimation
+    int maxUnison;    // oscillators per voice
+    int maxPolyphony; // voices per part
+};
+
+/*
+ Lowers the quality tier when the audio thread gets close to its deadline,
+ and raises it again once there has been headroom for a while. Running out
+ of time means a dropout, so the governor steps down quickly and steps up
+ slowly.
+
+ The tier only changes between blocks, and new limits only apply to notes
+ that start afterwards, so a change never cuts off a playing note.
+ */
+class QualityGovernor
+{
+  public:
+    static constexpr int NUM_TIERS = 4;
+
+    static constexpr std::array<QualityTier, NUM_TIERS> tiers{{
+        {1, 8, 8},
+        {2, 4, 8},
+        {4, 2, 6},
+        {8, 1, 4},
+    }};
+
+    // Smoothed load above which the tier steps down, and below which it may
+    // step back up. Several blocks in a row over the deadline also step
+    // down, a single late block can be a hiccup of the host or the system.
+    static constexpr float STEP_DOWN_LOAD = 0.75f;
+    static constexpr float STEP_UP_LOAD = 0.4f;
+    static constexpr int STEP_DOWN_OVERRUNS = 3;
+
+    // Blocks to wait after a change before the next step down or up. The
+    // wait before stepping up is long so the tier doesn't go back and forth.
+    static constexpr int STEP_DOWN_BLOCKS = 8;
+    static constexpr int STEP_UP_BLOCKS = 400;
+
+    void reset()
+    {
+        smoothedLoad = 0.0f;
+        blocksSinceChange = 0;
+        overruns = 0;
+        tier.store(0, std::memory_order_relaxed);
+    }
+
+    // Audio thread, once per block with the block's load. Returns true if the
+    // tier has changed.
+    bool update(float load)
+    {
+        int current = tier.load(std::memory_order_relaxed);
+        int next = current;
+
+        if (!enabled.load(std::memory_order_relaxed))
+        {
+            next = 0;
+        }
+        else
+        {
+            smoothedLoad += 0.1f * (load - smoothedLoad);
+            ++blocksSinceChange;
+            overruns = (load > 1.0f) ? overruns + 1 : 0;
+
+            bool overloaded = smoothedLoad > STEP_DOWN_LOAD || overruns >= STEP_DOWN_OVERRUNS;
+            if (overloaded && current < NUM_TIERS - 1 && blocksSinceChange >= STEP_DOWN_BLOCKS)
+            {
+                next = current + 1;
+            }
+            else if (smoothedLoad < STEP_UP_LOAD && current > 0 &&
+                     blocksSinceChange >= STEP_UP_BLOCKS)
+            {
+                next = current - 1;
+            }
+        }
+
+        if (next == current)
+            return false;
+
+        blocksSinceChange = 0;
+        tier.store(next, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Can be read from any thread
+    int getTier() const { return tier.load(std::memory_order_relaxed); }
+    const QualityTier &getLimits() const { return tiers[size_t(getTier())]; }
+
+    // Off by default, the user opts in. When disabled, the governor goes back
+    // to full quality at the next block.
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<bool> enabled{false};
+    std::atomic<int> tier{0};
+
+    float smoothedLoad = 0.0f;
+    int blocksSinceChange = 0;
+    int overruns = 0; // consecutive blocks over the deadline
+};
@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    RealtimeChecks.cpp
+    Created: 20 Oct 2026 2:17:36pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#include "RealtimeChecks.h"
+
+#if JX11_RT_CHECKS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define JX11_RT_BACKTRACE 1
+#else
+#define JX11_RT_BACKTRACE 0
+#endif
+
+#ifndef JX11_RT_WRAP
+#define JX11_RT_WRAP 0
+#endif
+
+#if JX11_RT_WRAP
+#include <pthread.h>
+
+extern "C"
+{
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t count, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+    void __real_free(void *ptr);
+    int __real_pthread_mutex_lock(pthread_mutex_t *mutex);
+}
+#endif
+
+namespace RealtimeChecks
+{
+namespace
+{
+std::array<Violation, MAX_VIOLATIONS> violations;
+std::atomic<int> numViolations{0};
+
+// Only the audio thread inside processBlock records anything. The thread is
+// compared by ID because thread_local storage may itself allocate when it is
+// first touched.
+std::atomic<bool> active{false};
+std::atomic<juce::Thread::ThreadID> audioThread{nullptr};
+
+int captureFrames(void **frames)
+{
+#if JX11_RT_BACKTRACE
+    return backtrace(frames, Violation::MAX_FRAMES);
+#elif defined(_MSC_VER)
+    frames[0] = _ReturnAddress();
+    return 1;
+#else
+    frames[0] = __builtin_return_address(0);
+    return 1;
+#endif
+}
+
+const char *kindName(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::allocation:
+        return "allocation";
+    case Kind::deallocation:
+        return "deallocation";
+    case Kind::lock:
+        return "lock";
+    }
+    return "";
+}
+
+void *allocate(size_t size)
+{
+#if JX11_RT_WRAP
+    return __real_malloc(size);
+#else
+    return std::malloc(size);
+#endif
+}
+
+void release(void *ptr)
+{
+#if JX11_RT_WRAP
+    __real_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+} // namespace
+
+ScopedAudioSection::ScopedAudioSection()
+{
+    audioThread.store(juce::Thread::getCurrentThreadId(), std::memory_order_relaxed);
+    active.store(true, std::memory_order_release);
+}
+
+ScopedAudioSection::~ScopedAudioSection() { active.store(false, std::memory_order_release); }
+
+void record(Kind kind, size_t size) noexcept
+{
+    if (!active.load(std::memory_order_acquire) ||
+        juce::Thread::getCurrentThreadId() != audioThread.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    // Anything the stack trace does is not recorded again
+    active.store(false, std::memory_order_relaxed);
+
+    int index = numViolations.fetch_add(1, std::memory_order_relaxed);
+    if (index < MAX_VIOLATIONS)
+    {
+        Violation &violation = violations[index];
+        violation.kind = kind;
+        violation.size = size;
+        violation.numFrames = captureFrames(violation.frames.data());
+    }
+
+    active.store(true, std::memory_order_relaxed);
+}
+
+void prepare()
+{
+    std::array<void *, Violation::MAX_FRAMES> frames;
+    captureFrames(frames.data());
+}
+
+int getNumViolations() noexcept { return numViolations.load(std::memory_order_relaxed); }
+
+juce::String report()
+{
+    int total = getNumViolations();
+    juce::String text = "JX11 real-time checks: " + juce::String(total) + " violations\n";
+
+    for (int i = 0; i < std::min(total, MAX_VIOLATIONS); ++i)
+    {
+        const Violation &violation = violations[i];
+        text += juce::String(kindName(violation.kind));
+        if (violation.kind != Kind::lock)
+            text += " of " + juce::String(juce::int64(violation.size)) + " bytes";
+        text += "\n";
+
+#if JX11_RT_BACKTRACE
+        char **symbols = backtrace_symbols(violation.frames.data(), violation.numFrames);
+        for (int f = 0; f < violation.numFrames; ++f)
+        {
+            text += "    " + juce::String(symbols != nullptr ? symbols[f] : "?") + "\n";
+        }
+        std::free(symbols);
+#else
+        for (int f = 0; f < violation.numFrames; ++f)
+        {
+            auto address = juce::pointer_sized_int(violation.frames[f]);
+            text += "    0x" + juce::String::toHexString(address) + "\n";
+        }
+#endif
+    }
+    return text;
+}
+
+void reset() { numViolations.store(0, std::memory_order_relaxed); }
+} // namespace RealtimeChecks
+
+void *operator new(std::size_t size)
+{
+    RealtimeChecks::record(RealtimeChecks::Kind::allocation, size);
+    if (void *ptr = RealtimeChecks::allocate(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    RealtimeChecks::record(RealtimeChecks::Kind::allocation, size);
+    return RealtimeChecks::allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr != nullptr)
+        RealtimeChecks::record(RealtimeChecks::Kind::deallocation, 0);
+    RealtimeChecks::release(ptr);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { operator delete(ptr); }
+
+#if JX11_RT_WRAP
+extern "C"
+{
+    void *__wrap_malloc(size_t size)
+    {
+        RealtimeChecks::record(RealtimeChecks::Kind::allocation, size);
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t count, size_t size)
+    {
+        RealtimeChecks::record(RealtimeChecks::Kind::allocation, count * size);
+        return __real_calloc(count, size);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size)
+    {
+        RealtimeChecks::record(RealtimeChecks::Kind::allocation, size);
+        return __real_realloc(ptr, size);
+    }
+
+    void __wrap_free(void *ptr)
+    {
+        if (ptr != nullptr)
+            RealtimeChecks::record(RealtimeChecks::Kind::deallocation, 0);
+        __real_free(ptr);
+    }
+
+    int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
+    {
+        RealtimeChecks::record(RealtimeChecks::Kind::lock, 0);
+        return __real_pthread_mutex_lock(mutex);
+    }
+}
+#endif
+
+#endif
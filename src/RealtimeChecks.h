@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    RealtimeChecks.h
+    Created: 20 Oct 2026 2:17:36pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/*
+ Records every allocation, deallocation and mutex lock made by the audio
+ thread while it is inside processBlock. Only exists when the plugin is built
+ with the JX11_RT_CHECKS CMake option, otherwise JX11_RT_SECTION expands to
+ nothing. Use a build without DBG() output, DBG() itself allocates.
+
+ operator new and delete are replaced on every platform. On Linux the linker
+ also wraps malloc, calloc, realloc, free and pthread_mutex_lock, which
+ catches the C library calls made by the plugin and the JUCE modules compiled
+ into it, but not calls made from inside other shared libraries.
+
+ A violation is written to a preallocated buffer, so recording one doesn't
+ cause another.
+ */
+
+#ifndef JX11_RT_CHECKS
+#define JX11_RT_CHECKS 0
+#endif
+
+#if JX11_RT_CHECKS
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+namespace RealtimeChecks
+{
+enum class Kind
+{
+    allocation,
+    deallocation,
+    lock,
+};
+
+struct Violation
+{
+    static constexpr int MAX_FRAMES = 8;
+
+    Kind kind;
+    size_t size;
+    int numFrames;
+    std::array<void *, MAX_FRAMES> frames;
+};
+
+static constexpr int MAX_VIOLATIONS = 256;
+
+// Marks the calling thread as the audio thread until the end of the scope
+class ScopedAudioSection
+{
+  public:
+    ScopedAudioSection();
+    ~ScopedAudioSection();
+
+  private:
+    JUCE_DECLARE_NON_COPYABLE(ScopedAudioSection)
+};
+
+// Called by the hooks, does nothing outside an audio section
+void record(Kind kind, size_t size) noexcept;
+
+// Call before the first audio section, capturing a stack trace may allocate
+// the first time
+void prepare();
+
+// Total number of violations, including those that didn't fit the buffer
+int getNumViolations() noexcept;
+
+// One line per violation with its call stack. Don't call while audio is
+// running.
+juce::String report();
+
+void reset();
+} // namespace RealtimeChecks
+
+#define JX11_RT_SECTION() RealtimeChecks::ScopedAudioSection JUCE_JOIN_MACRO(rtSection, __LINE__)
+
+#else
+
+#define JX11_RT_SECTION()
+
+#endif
@@ -22,6 +22,9 @@ RotaryKnob::RotaryKnob()
     slider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, textBoxHeight);
     addAndMakeVisible(slider);
 
+    // The whole area is painted, nothing behind the knob needs redrawing
+    setOpaque(true);
+
     setBounds(0, 0, 100, 120);
 }
 
@@ -29,19 +32,35 @@ RotaryKnob::~RotaryKnob() {}
 
 void RotaryKnob::paint(juce::Graphics &g)
 {
-    /* This demo code just fills the component's background and
-       draws some placeholder text to get you started.
+    // Turning the knob only repaints the slider's area, the background under
+    // it is copied from the cached image
+    float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (background.isNull() || backgroundLabel != label || backgroundScale != scale)
+    {
+        renderBackground(scale);
+    }
+
+    g.drawImage(background, getLocalBounds().toFloat());
+}
+
+void RotaryKnob::renderBackground(float scale)
+{
+    auto bounds = getLocalBounds();
+    int width = std::max(1, juce::roundToInt(float(bounds.getWidth()) * scale));
+    int height = std::max(1, juce::roundToInt(float(bounds.getHeight()) * scale));
+
+    background = juce::Image(juce::Image::RGB, width, height, false);
+    backgroundLabel = label;
+    backgroundScale = scale;
 
-       You should replace everything in this method with your own
-       drawing code..
-    */
+    juce::Graphics g(background);
+    g.addTransform(juce::AffineTransform::scale(scale));
 
     g.fillAll(getLookAndFeel().findColour(
         juce::ResizableWindow::backgroundColourId)); // clear the background
 
     g.setColour(juce::Colours::white);
     g.setFont(15.0f);
-    auto bounds = getLocalBounds();
     g.drawText(label, juce::Rectangle<int>{0, 0, bounds.getWidth(), labelHeight},
                juce::Justification::centred);
 }
@@ -52,4 +71,50 @@ void RotaryKnob::resized()
     // components that your component contains..
     auto bounds = getLocalBounds();
     slider.setBounds(0, labelHeight, bounds.getWidth(), bounds.getHeight() - labelHeight);
+
+    background = {};
+}
+
+//==============================================================================
+KnobAttachment::KnobAttachment(juce::AudioProcessorValueTreeState &apvts,
+                               const juce::ParameterID &id, RotaryKnob &knob)
+    : parameter(*apvts.getParameter(id.getParamID())), slider(knob.slider)
+{
+    // Same range and text as the parameter, see APVTS::SliderAttachment
+    const juce::NormalisableRange<float> range = parameter.getNormalisableRange();
+    slider.setNormalisableRange(
+        {double(range.start), double(range.end),
+         [range](double, double, double v) { return double(range.convertFrom0to1(float(v))); },
+         [range](double, double, double v) { return double(range.convertTo0to1(float(v))); },
+         [range](double, double, double v) { return double(range.snapToLegalValue(float(v))); }});
+
+    slider.textFromValueFunction = [this](double v) {
+        return parameter.getText(parameter.convertTo0to1(float(v)), 0);
+    };
+    slider.valueFromTextFunction = [this](const juce::String &text) {
+        return double(parameter.convertFrom0to1(parameter.getValueForText(text)));
+    };
+    slider.setDoubleClickReturnValue(
+        true, double(parameter.convertFrom0to1(parameter.getDefaultValue())));
+
+    slider.onDragStart = [this] { parameter.beginChangeGesture(); };
+    slider.onDragEnd = [this] { parameter.endChangeGesture(); };
+    slider.onValueChange = [this] {
+        parameter.setValueNotifyingHost(parameter.convertTo0to1(float(slider.getValue())));
+    };
+
+    value.store(parameter.getValue());
+    parameter.addListener(this);
+    update();
+}
+
+KnobAttachment::~KnobAttachment() { parameter.removeListener(this); }
+
+void KnobAttachment::update()
+{
+    if (changed.exchange(false))
+    {
+        slider.setValue(double(parameter.convertFrom0to1(value.load())),
+                        juce::dontSendNotification);
+    }
 }
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_processors/juce_audio_processors.h>
 
 //==============================================================================
 /*
@@ -28,5 +29,47 @@ class RotaryKnob : public juce::Component
     void resized() override;
 
   private:
+    // The background and label, which don't change when the knob is turned
+    juce::Image background;
+    juce::String backgroundLabel;
+    float backgroundScale = 0.0f;
+
+    void renderBackground(float scale);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RotaryKnob)
 };
+
+/*
+ Connects a knob to a parameter, like APVTS::SliderAttachment. Changes made
+ by the host are only shown when update() is called, which the editor does
+ from its timer, so fast automation costs one repaint per timer tick instead
+ of one per change.
+ */
+class KnobAttachment : private juce::AudioProcessorParameter::Listener
+{
+  public:
+    KnobAttachment(juce::AudioProcessorValueTreeState &apvts, const juce::ParameterID &id,
+                   RotaryKnob &knob);
+    ~KnobAttachment() override;
+
+    // Message thread
+    void update();
+
+  private:
+    void parameterValueChanged(int, float newValue) override
+    {
+        value.store(newValue);
+        changed.store(true);
+    }
+
+    void parameterGestureChanged(int, bool) override {}
+
+    juce::RangedAudioParameter &parameter;
+    juce::Slider &slider;
+
+    // Normalized value last set by anyone, may be written by the audio thread
+    std::atomic<float> value;
+    std::atomic<bool> changed{true};
+
+    JUCE_DECLARE_NON_COPYABLE(KnobAttachment)
+};
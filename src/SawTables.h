@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    SawTables.h
+    Created: 20 Oct 2026 2:41:08pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+/*
+ Band-limited sawtooth tables for the phase accumulator oscillator, one per
+ octave. Level l holds 2^l harmonics, which stay below Nyquist for every
+ phase increment in the octave that forIncrement() picks it for. The waveform
+ falls from +0.5 to -0.5 like the integrated output of the BLIT oscillator.
+ */
+class SawTables
+{
+  public:
+    static constexpr int SIZE_BITS = 11;
+    static constexpr int SIZE = 1 << SIZE_BITS;
+    static constexpr int NUM_LEVELS = SIZE_BITS; // up to SIZE / 2 harmonics
+
+    SawTables()
+    {
+        // sin(TAU * i / SIZE) by rotating a unit vector rather than calling
+        // std::sin, so that the tables don't depend on the math library
+        std::array<double, SIZE> sine;
+        const double c = 0.9999952938095762;
+        const double s = 0.003067956762965976;
+        double x = 1.0;
+        double y = 0.0;
+        for (int i = 0; i < SIZE; ++i)
+        {
+            sine[i] = y;
+            double next = x * c - y * s;
+            y = x * s + y * c;
+            x = next;
+        }
+
+        // Level l holds the first 2^l harmonics, so one pass over the
+        // harmonics builds every level: each one is the running sum at the
+        // point where the count of harmonics reaches a power of two
+        std::array<double, SIZE> sum{};
+        for (int k = 1; k <= SIZE / 2; ++k)
+        {
+            const double scale = 3.14159265358979323846 * double(k);
+            for (int i = 0; i < SIZE; ++i)
+            {
+                sum[i] += sine[(k * i) & (SIZE - 1)] / scale;
+            }
+
+            if (std::has_single_bit(unsigned(k)))
+            {
+                auto &level = levels[size_t(std::countr_zero(unsigned(k)))];
+                for (int i = 0; i < SIZE; ++i)
+                {
+                    level[i] = float(sum[i]);
+                }
+
+                // One extra point so the interpolation never has to wrap
+                level[SIZE] = level[0];
+            }
+        }
+    }
+
+    // inc is the phase increment per sample, a full cycle is 2^32
+    inline const float *forIncrement(uint32_t inc) const
+    {
+        // inc in [2^(31 - z), 2^(32 - z)) allows 2^(z - 1) harmonics
+        int level = std::clamp(std::countl_zero(inc) - 1, 0, NUM_LEVELS - 1);
+        return levels[level].data();
+    }
+
+  private:
+    std::array<std::array<float, SIZE + 1>, NUM_LEVELS> levels;
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    SharedTables.h
+    Created: 20 Oct 2026 5:26:14pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+/*
+ Read-only tables that are shared by all plugin instances in the process.
+ A table is created by the first instance that asks for it and freed when
+ the last instance holding it lets go, so a session with a hundred instances
+ has one copy instead of a hundred.
+
+ Tables are looked up by sample rate and a configuration number, such as the
+ size of the table. Tables that don't depend on the sample rate use 0.
+
+ get() locks and may allocate, call it from prepareToPlay or the constructor,
+ never from the audio thread. Holding the returned pointer is free.
+ */
+class SharedTables
+{
+  public:
+    struct Key
+    {
+        double sampleRate;
+        int config;
+
+        bool operator<(const Key &other) const
+        {
+            if (sampleRate != other.sampleRate)
+                return sampleRate < other.sampleRate;
+            return config < other.config;
+        }
+    };
+
+    // create() returns a std::shared_ptr to a new table, it is only called
+    // when no instance holds a table for this key
+    template <typename Table, typename Create>
+    static std::shared_ptr<const Table> get(Key key, Create &&create)
+    {
+        static std::mutex mutex;
+        static std::map<Key, std::weak_ptr<const Table>> tables;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::weak_ptr<const Table> &entry = tables[key];
+        std::shared_ptr<const Table> table = entry.lock();
+        if (table == nullptr)
+        {
+            table = create();
+            entry = table;
+        }
+        return table;
+    }
+};
@@ -12,7 +12,6 @@
 #include "Utils.h"
 
 static const float ANALOG = 0.002f;
-static const int SUSTAIN = -1;
 
 Synth::Synth()
 {
@@ -22,6 +21,15 @@ Synth::Synth()
 void Synth::allocateResources(double sampleRate_, int samplesPerBlock)
 {
     sampleRate = static_cast<float>(sampleRate_);
+    cutoffScale = -TAU / sampleRate;
+
+    lfoTable = SharedTables::get<LFOTable>({0.0, LFOTable::SIZE},
+                                           [] { return std::make_shared<LFOTable>(); });
+    sawTables = SharedTables::get<SawTables>({0.0, SawTables::SIZE},
+                                             [] { return std::make_shared<SawTables>(); });
+    saturationTable = SharedTables::get<SaturationTable>({0.0, 128},
+                                                         &Filter::createSaturationTable);
+
     juce::dsp::ProcessSpec spec;
     spec.sampleRate = sampleRate;
     spec.maximumBlockSize = samplesPerBlock;
@@ -29,8 +37,9 @@ void Synth::allocateResources(double sampleRate_, int samplesPerBlock)
 
     for (int v = 0; v < MAX_VOICES; ++v)
     {
-        voices[v].filter.setMode(juce::dsp::LadderFilterMode::LPF12);
-        voices[v].filter.prepare(spec);
+        voices[v].sawTables = sawTables.get();
+        voices[v].filter.prepare(spec, *saturationTable);
+        voices[v].filterRight.prepare(spec, *saturationTable);
     }
 }
 
@@ -41,16 +50,18 @@ void Synth::deallocateResources()
 
 void Synth::reset()
 {
-    pitchBend = 1.0f;
-    sustainPedalPressed = false;
-    outputLevelSmoother.reset(sampleRate, 0.05);
-    lfo = 0.0f;
+    for (int p = 0; p < MAX_PARTS; ++p)
+        parts[p].reset(sampleRate);
+
     lfoStep = 0;
-    modWheel = 0.0f;
-    lastNote = 0;
-    pressure = 0.0f;
-    filterCtl = 0.0f;
-    filterZip = 0.0f;
+    filterZip.fill(0.0f);
+    audioRateActive = false;
+    logCutoff.fill(0.0f);
+    logCutoffStep.fill(0.0f);
+    logPeriod.fill(0.0f);
+    logPeriodStep.fill(0.0f);
+    channelVoice.fill(-1);
+    channelExpression.fill({});
 
     for (int v = 0; v < MAX_VOICES; ++v)
         voices[v].reset();
@@ -58,61 +69,133 @@ void Synth::reset()
     noiseGen.reset();
 }
 
-void Synth::render(float **outputBuffers, int sampleCount)
+void Synth::setNumParts(int newNumParts)
 {
-    float *outputBufferLeft = outputBuffers[0];
-    float *outputBufferRight = outputBuffers[1];
+    newNumParts = std::clamp(newNumParts, 1, MAX_PARTS);
 
-    for (int v = 0; v < MAX_VOICES; ++v)
+    if (newNumParts != numParts)
+    {
+        const int newPoolSize = std::min(MAX_VOICES, newNumParts * MAX_POLYPHONY);
+
+        // Voices of parts that no longer exist would have no parameters, and
+        // voices outside the pool would never be rendered or released
+        for (int v = 0; v < MAX_VOICES; ++v)
+        {
+            if (voices[v].part >= newNumParts || v >= newPoolSize)
+                voices[v].reset();
+        }
+
+        // A disabled part that comes back starts with no keys or pedals down
+        for (int p = newNumParts; p < numParts; ++p)
+        {
+            parts[p].keys.reset();
+            parts[p].monoVoice = -1;
+            parts[p].lastNote = 0;
+        }
+
+        for (int p = 0; p < newNumParts; ++p)
+        {
+            if (parts[p].monoVoice >= newPoolSize)
+                parts[p].monoVoice = -1;
+        }
+
+        numParts = newNumParts;
+        poolSize = newPoolSize;
+    }
+}
+
+void Synth::render(float **outputBuffers, int sampleCount)
+{
+    for (int v = 0; v < poolSize; ++v)
     {
         Voice &voice = voices[v];
         if (voice.env.isActive())
         {
-            voice.osc1.period = voice.period * pitchBend;
-            voice.osc2.period = voice.osc1.period * detune;
-            voice.glideRate = glideRate;
-            voice.filterQ = filterQ;
-            voice.pitchBend = pitchBend;
-            voice.filterEnvDepth = filterEnvDepth;
+            const Part &part = parts[voice.part];
+            updatePeriod(voice);
+            voice.glideRate = part.glideRate;
+            voice.filterQ = part.filterQ;
+            voice.filterEnvDepth = part.filterEnvDepth;
+        }
+    }
+
+    // Lowering lfoMax to 1 already updates on every sample
+    bool audioRate = audioRateModulation && lfoMax > 1;
+    if (audioRate && !audioRateActive)
+    {
+        for (int v = 0; v < poolSize; ++v)
+        {
+            if (voices[v].env.isActive())
+                snapModulation(v);
         }
     }
+    audioRateActive = audioRate;
+
+    std::array<float, MAX_PARTS> outputLevel;
+    std::array<float, MAX_PARTS> outputLeft;
+    std::array<float, MAX_PARTS> outputRight;
 
     for (int sample = 0; sample < sampleCount; ++sample)
     {
-        const float noise = noiseGen.nextValue() * noiseMix;
+        const float noise = noiseGen.nextValue();
         updateLFO();
-        float outputLeft = 0.0f;
-        float outputRight = 0.0f;
 
-        for (int v = 0; v < MAX_VOICES; ++v)
+        if (audioRateActive)
+            updateModulation();
+
+        for (int p = 0; p < numParts; ++p)
+        {
+            outputLevel[p] = parts[p].outputLevelSmoother.getNextValue();
+        }
+
+        for (int b = 0; b < numBuses; ++b)
+        {
+            outputLeft[b] = 0.0f;
+            outputRight[b] = 0.0f;
+        }
+
+        for (int v = 0; v < poolSize; ++v)
         {
             Voice &voice = voices[v];
 
             if (voice.env.isActive())
             {
-                float output = voice.render(noise);
-
-                outputLeft += output * voice.panLeft;
-                outputRight += output * voice.panRight;
+                const int p = voice.part;
+                const int b = partBus[p];
+
+                float left, right;
+                if (audioRateActive)
+                {
+                    setOscillatorPeriods(voice, voicePeriod[v]);
+                    voice.render(noise * parts[p].noiseMix, left, right, cutoffTransform[v]);
+                }
+                else
+                {
+                    voice.render(noise * parts[p].noiseMix, left, right);
+                }
+
+                outputLeft[b] += left * outputLevel[p];
+                outputRight[b] += right * outputLevel[p];
             }
         }
 
-        float outputLevel = outputLevelSmoother.getNextValue();
-
-        outputLeft *= outputLevel;
-        outputRight *= outputLevel;
-
-        if (outputBufferRight != nullptr)
-        {
-            outputBufferLeft[sample] = outputLeft;
-            outputBufferRight[sample] = outputRight;
-        }
-        else
+        for (int b = 0; b < numBuses; ++b)
         {
-            outputBufferLeft[sample] = (outputLeft + outputRight) * 0.5f;
+            float *outputBufferLeft = outputBuffers[2 * b];
+            float *outputBufferRight = outputBuffers[2 * b + 1];
+
+            if (outputBufferRight != nullptr)
+            {
+                outputBufferLeft[sample] = outputLeft[b];
+                outputBufferRight[sample] = outputRight[b];
+            }
+            else
+            {
+                outputBufferLeft[sample] = (outputLeft[b] + outputRight[b]) * 0.5f;
+            }
         }
     }
-    for (int v = 0; v < MAX_VOICES; ++v)
+    for (int v = 0; v < poolSize; ++v)
     {
         Voice &voice = voices[v];
 
@@ -120,19 +203,78 @@ void Synth::render(float **outputBuffers, int sampleCount)
         {
             voice.env.reset();
             voice.filter.reset();
+            voice.filterRight.reset();
+        }
+    }
+
+    JX11_PROBE(protectYourEars);
+    for (int b = 0; b < numBuses; ++b)
+    {
+        protectYourEars(outputBuffers[2 * b], sampleCount, &protectionStats);
+        protectYourEars(outputBuffers[2 * b + 1], sampleCount, &protectionStats);
+    }
+}
+
+int Synth::getVoiceLevels(std::array<float, MAX_VOICES> &levels) const
+{
+    int activeVoices = 0;
+    for (int v = 0; v < MAX_VOICES; ++v)
+    {
+        const Envelope &env = voices[v].env;
+        if (env.isActive())
+        {
+            levels[v] = env.level;
+            activeVoices += 1;
+        }
+        else
+        {
+            levels[v] = 0.0f;
         }
     }
+    return activeVoices;
+}
+
+int Synth::getNumActiveVoices(int p) const
+{
+    int activeVoices = 0;
+    for (int v = 0; v < poolSize; ++v)
+    {
+        if (voices[v].part == p && voices[v].env.isActive())
+            activeVoices += 1;
+    }
+    return activeVoices;
+}
 
-    protectYourEars(outputBufferLeft, sampleCount);
-    protectYourEars(outputBufferRight, sampleCount);
+int Synth::partForChannel(int channel) const
+{
+    if (numParts == 1 || mpeEnabled)
+        return 0;
+
+    return (channel < numParts) ? channel : -1;
 }
 
 void Synth::midiMesage(uint8_t data0, uint8_t data1, uint8_t data2)
 {
+    int channel = data0 & 0x0F;
+
+    if (mpeEnabled && channel != MPE_MASTER_CHANNEL)
+    {
+        if ((data0 & 0xF0) == 0xE0 || (data0 & 0xF0) == 0xD0 ||
+            ((data0 & 0xF0) == 0xB0 && data1 == 0x4A))
+        {
+            noteExpression(channel, data0, data1, data2);
+            return;
+        }
+    }
+
+    int p = partForChannel(channel);
+    if (p < 0)
+        return;
+
     switch (data0 & 0xF0)
     {
     case 0x80: // Note off
-        noteOff(data1 & 0x7F);
+        noteOff(channel, data1 & 0x7F);
         break;
     case 0x90:
     { // Note on
@@ -141,139 +283,316 @@ void Synth::midiMesage(uint8_t data0, uint8_t data1, uint8_t data2)
 
         if (velo > 0)
         {
-            noteOn(note, velo);
+            noteOn(channel, note, velo);
         }
         else
         {
-            noteOff(note);
+            noteOff(channel, note);
         }
         break;
     }
     case 0xE0:
-        pitchBend = std::exp(-0.000014102f * float(data1 + 128 * data2 - 8192));
+        parts[p].pitchBend = std::exp(-0.000014102f * float(data1 + 128 * data2 - 8192));
         break;
     case 0xB0:
-        controlChange(data1, data2);
+        controlChange(p, data1, data2);
         break;
-    case 0x01:
-        modWheel = 0.000005f * float(data2 * data2);
+    case 0xD0:
+        parts[p].pressure = 0.0001f * float(data1 * data1);
+        break;
+    }
+}
+
+void Synth::noteExpression(int channel, uint8_t data0, uint8_t data1, uint8_t data2)
+{
+    NoteExpression &expression = channelExpression[channel];
+
+    switch (data0 & 0xF0)
+    {
+    case 0xE0:
+        expression.pitchBend =
+            std::exp(-0.000007051f * MPE_BEND_RANGE * float(data1 + 128 * data2 - 8192));
         break;
     case 0xD0:
-        pressure = 0.0001f * float(data1 * data2);
+        expression.pressure = float(data1) / 127.0f;
+        break;
+    case 0xB0:
+        expression.timbre = float(data2) / 127.0f;
         break;
     }
+
+    // The lookup can be stale if the voice has been stolen by another channel
+    int v = channelVoice[channel];
+    if (v >= 0 && voices[v].channel == channel)
+    {
+        voices[v].expression = expression;
+    }
 }
 
-void Synth::startVoice(int v, int note, int velocity)
+void Synth::startVoice(int v, int p, int note, int velocity)
 {
+    Part &part = parts[p];
     Voice &voice = voices[v];
     Envelope &env = voice.env;
     Envelope &filterEnv = voice.filterEnv;
 
+    if (voice.part != p)
+    {
+        // The lane was following another part's modulation
+        voice.part = p;
+        modMatrix.setLaneRoutes(v, part.modRoutes);
+        filterZip[v] = part.filterKeytracking + part.filterCtl;
+    }
+
     int noteDistance = 0;
 
-    float period = calcPeriod(v, note);
+    float period = calcPeriod(part, v, note);
     float vel = 0.004f * float(velocity + 64) * (velocity + 64) - 8.0f;
 
+    voice.setUnison(part.numUnison, part.unisonSpread);
+    voice.tableOscillators = oscillatorMode == OscillatorMode::table;
+    voice.hold = Voice::KEY_DOWN;
     voice.note = note;
     voice.updatePanning();
     voice.target = period;
-    voice.osc1.amplitude = vel * volumeTrim;
-    voice.osc2.amplitude = voice.osc1.amplitude * oscMix;
+
+    float amplitude = vel * part.volumeTrim * part.unisonGain;
+    for (int i = 0; i < voice.numUnison; ++i)
+    {
+        voice.unison[i].osc1.amplitude = amplitude;
+        voice.unison[i].osc2.amplitude = amplitude * part.oscMix;
+    }
     voice.cutoff = sampleRate / (period * PI);
-    voice.cutoff *= std::exp(velocitySensitivity * float(velocity - 64));
+    voice.cutoff *= std::exp(part.velocitySensitivity * float(velocity - 64));
+    voice.lfo.reset();
 
-    if (lastNote > 0)
+    if (part.lastNote > 0)
     {
-        if ((glideMode == 2) || ((glideMode == 1) && isPlayingLegatoStyle()))
+        if ((part.glideMode == 2) || ((part.glideMode == 1) && isPlayingLegatoStyle(p)))
         {
-            noteDistance = note - lastNote;
+            noteDistance = note - part.lastNote;
         }
     }
-    voice.period = period * std::pow(1.059463094359f, float(noteDistance) - glideBend);
+    voice.period = period * std::pow(1.059463094359f, float(noteDistance) - part.glideBend);
 
     if (voice.period < 6.0f)
         voice.period = 6.0f;
 
-    lastNote = note;
+    part.lastNote = note;
     voice.note = note;
     voice.updatePanning();
 
-    if (vibrato == 0.0f && pwmDepth > 0.0f)
+    if (part.vibrato == 0.0f && part.pwmDepth > 0.0f)
     {
-        voice.osc2.squareWave(voice.osc1, voice.period);
+        for (int i = 0; i < voice.numUnison; ++i)
+        {
+            voice.squareWave(i, voice.period * part.unisonDetune[i]);
+        }
     }
 
-    filterEnv.attackMultiplier = filterAttack;
-    filterEnv.decayMultiplier = filterDecay;
-    filterEnv.sustainLevel = filterSustain;
-    filterEnv.releaseMultiplier = filterRelease;
+    filterEnv.attackMultiplier = part.filterAttack;
+    filterEnv.decayMultiplier = part.filterDecay;
+    filterEnv.sustainLevel = part.filterSustain;
+    filterEnv.releaseMultiplier = part.filterRelease;
     filterEnv.attack();
 
-    env.attackMultiplier = envAttack;
-    env.decayMultiplier = envDecay;
-    env.sustainLevel = envSustain;
-    env.releaseMultiplier = envRelease;
+    env.attackMultiplier = part.envAttack;
+    env.decayMultiplier = part.envDecay;
+    env.sustainLevel = part.envSustain;
+    env.releaseMultiplier = part.envRelease;
     env.attack();
 }
 
-void Synth::noteOn(int note, int velocity)
+void Synth::noteOn(int channel, int note, int velocity)
 {
+    int p = partForChannel(channel);
+    Part &part = parts[p];
     int v = 0;
 
-    if (ignoreVelocity)
+    if (part.ignoreVelocity)
         velocity = 80;
 
-    if (numVoices == 1)
+    if (part.keys.softPedal)
+        velocity = velocity * 2 / 3;
+
+    part.keys.held.push(note);
+
+    if (part.numVoices == 1)
     {
-        if (voices[0].note > 0)
+        // With low or high note priority the new note may not be the one
+        // that plays, it then doesn't change the velocity either
+        note = part.keys.held.select(part.notePriority);
+
+        // Keep using the same voice for as long as no other part takes it
+        int monoVoice = part.monoVoice;
+        if (monoVoice >= 0 && voices[monoVoice].part == p)
         {
-            shiftQueuedNotes();
-            restartMonoVoice(note, velocity);
-            return;
+            if (voices[monoVoice].hold & Voice::KEY_DOWN)
+            {
+                bool isNewNote = note == part.keys.held.last();
+                if (isNewNote || voices[monoVoice].note != note)
+                {
+                    restartMonoVoice(p, note, isNewNote ? velocity : -1);
+                    assignChannel(monoVoice, channel);
+                }
+                return;
+            }
+            v = monoVoice;
+        }
+        else
+        {
+            v = findFreeVoice(p);
         }
+        part.monoVoice = v;
     }
     else
     {
-        v = findFreeVoice();
+        // Striking a note again while the pedal holds it reuses its voice
+        v = -1;
+        if (part.keys.sustained.test(note))
+        {
+            v = findSustainedVoice(p, note);
+            part.keys.sustained.reset(note);
+        }
+
+        if (v < 0)
+            v = findFreeVoice(p);
     }
 
-    startVoice(v, note, velocity);
+    startVoice(v, p, note, velocity);
+    assignChannel(v, channel);
+    snapModulation(v);
 }
 
-void Synth::noteOff(int note)
+void Synth::assignChannel(int v, int channel)
 {
-    if ((numVoices == 1) && (voices[0].note == note))
+    voices[v].channel = channel;
+    voices[v].expression = mpeEnabled ? channelExpression[channel] : NoteExpression{};
+    channelVoice[channel] = v;
+}
+
+void Synth::noteOff(int channel, int note)
+{
+    int p = partForChannel(channel);
+    Part &part = parts[p];
+    int monoVoice = part.monoVoice;
+
+    part.keys.held.remove(note);
+
+    if ((part.numVoices == 1) && monoVoice >= 0 && (voices[monoVoice].part == p) &&
+        (voices[monoVoice].note == note) && (voices[monoVoice].hold & Voice::KEY_DOWN))
     {
-        int queuedNote = nextQueuedNote();
-        if (queuedNote > 0)
+        // Go back to one of the keys that are still down
+        int heldNote = part.keys.held.select(part.notePriority);
+        if (heldNote > 0)
         {
-            restartMonoVoice(queuedNote, -1);
+            restartMonoVoice(p, heldNote, -1);
         }
     }
 
-    for (int v = 0; v < MAX_VOICES; v++)
+    for (int v = 0; v < poolSize; v++)
     {
-        if (voices[v].note == note)
+        // In mono mode the queued notes don't remember their channel
+        bool sameChannel = !mpeEnabled || part.numVoices == 1 || voices[v].channel == channel;
+
+        Voice &voice = voices[v];
+
+        if (voice.part == p && voice.note == note && (voice.hold & Voice::KEY_DOWN) &&
+            sameChannel)
         {
-            if (sustainPedalPressed)
+            voice.hold &= ~Voice::KEY_DOWN;
+
+            if (part.keys.sustainPedal)
             {
-                voices[v].note = SUSTAIN;
+                voice.hold |= Voice::SUSTAINED;
+                part.keys.sustained.set(note);
             }
-            else
+
+            if (voice.hold == 0)
+            {
+                voice.release();
+                voice.note = 0;
+            }
+        }
+    }
+}
+
+int Synth::findSustainedVoice(int p, int note) const
+{
+    for (int v = 0; v < poolSize; ++v)
+    {
+        const Voice &voice = voices[v];
+        if (voice.part == p && voice.note == note && voice.hold == Voice::SUSTAINED)
+            return v;
+    }
+    return -1;
+}
+
+void Synth::releaseHeldVoices(int p, uint8_t flag)
+{
+    for (int v = 0; v < poolSize; ++v)
+    {
+        Voice &voice = voices[v];
+        if (voice.part == p && (voice.hold & flag))
+        {
+            voice.hold &= ~flag;
+
+            if (voice.hold == 0)
+            {
+                voice.release();
+                voice.note = 0;
+            }
+        }
+    }
+}
+
+void Synth::sustainPedal(int p, bool pressed)
+{
+    KeyState &keys = parts[p].keys;
+    keys.sustainPedal = pressed;
+
+    if (!pressed && keys.sustained.any())
+    {
+        releaseHeldVoices(p, Voice::SUSTAINED);
+        keys.sustained.clear();
+    }
+}
+
+void Synth::sostenutoPedal(int p, bool pressed)
+{
+    KeyState &keys = parts[p].keys;
+    if (pressed == keys.sostenutoPedal)
+        return;
+
+    keys.sostenutoPedal = pressed;
+
+    if (pressed)
+    {
+        // Only the notes that are down right now are held on to
+        for (int v = 0; v < poolSize; ++v)
+        {
+            Voice &voice = voices[v];
+            if (voice.part == p && (voice.hold & Voice::KEY_DOWN))
             {
-                voices[v].release();
-                voices[v].note = 0;
+                voice.hold |= Voice::SOSTENUTO;
+                keys.sostenuto.set(voice.note);
             }
         }
     }
+    else if (keys.sostenuto.any())
+    {
+        releaseHeldVoices(p, Voice::SOSTENUTO);
+        keys.sostenuto.clear();
+    }
 }
 
-float Synth::calcPeriod(int v, int note) const
+float Synth::calcPeriod(const Part &part, int v, int note) const
 {
-    float period = tune * std::exp2(-0.05776226505f * (float(note) + ANALOG * float(v)));
+    float period = part.tune * std::exp2(-0.05776226505f * (float(note) + ANALOG * float(v)));
 
-    while (period < 6.0f || (period * detune) < 6.0f)
+    // The highest oscillator of the unison stack must also stay in range
+    while ((period * part.unisonLowest) < 6.0f ||
+           (period * part.unisonLowest * part.detune) < 6.0f)
     {
         period += period;
     }
@@ -281,145 +600,290 @@ float Synth::calcPeriod(int v, int note) const
     return period;
 }
 
-int Synth::findFreeVoice() const
+int Synth::findFreeVoice(int p) const
 {
-    int v = 0;
+    // A part that has used up its polyphony steals from its own playing
+    // voices, otherwise the quietest voice in the pool is taken. An idle
+    // voice still tagged with the part doesn't count, taking it would give
+    // the part one voice more than its polyphony.
+    bool stealOwn = getNumActiveVoices(p) >= parts[p].numVoices;
+
+    int v = -1;
     float l = 100.0f;
 
-    for (int i = 0; i < MAX_VOICES; ++i)
+    for (int i = 0; i < poolSize; ++i)
     {
+        if (stealOwn && !(voices[i].part == p && voices[i].env.isActive()))
+            continue;
+
         if (voices[i].env.level < l && !voices[i].env.isInAttack())
         {
             l = voices[i].env.level;
             v = i;
         }
     }
+
+    if (v < 0)
+    {
+        // Everything is in its attack stage, take the part's first playing
+        // voice, or the first voice of the pool if the part may grow
+        v = 0;
+        for (int i = 0; stealOwn && i < poolSize; ++i)
+        {
+            if (voices[i].part == p && voices[i].env.isActive())
+            {
+                v = i;
+                break;
+            }
+        }
+    }
     return v;
 }
 
-void Synth::controlChange(uint8_t data1, uint8_t data2)
+void Synth::controlChange(int p, uint8_t data1, uint8_t data2)
 {
+    Part &part = parts[p];
+
     switch (data1)
     {
     case 0x40:
-        sustainPedalPressed = (data2 >= 64);
+        sustainPedal(p, data2 >= 64);
+        break;
+    case 0x42:
+        sostenutoPedal(p, data2 >= 64);
+        break;
+    case 0x43:
+        part.keys.softPedal = (data2 >= 64);
         break;
     case 0x4A:
-        filterCtl = 0.02f * float(data2);
+        part.filterCtl = 0.02f * float(data2);
         break;
     case 0x4B:
-        filterCtl = -0.03f * float(data2);
+        part.filterCtl = -0.03f * float(data2);
         break;
     default:
-        if (data1 >= 0x78)
+        if (data1 == 0x01)
         {
-            for (int v = 0; v < MAX_VOICES; ++v)
+            part.modWheel = 0.000005f * float(data2 * data2);
+        }
+        else if (data1 >= 0x78)
+        {
+            for (int v = 0; v < poolSize; ++v)
             {
-                voices[v].reset();
+                if (voices[v].part == p)
+                {
+                    voices[v].reset();
+                    voices[v].part = p;
+                }
             }
-            sustainPedalPressed = false;
+            part.keys.reset();
         }
         break;
     }
 }
 
-void Synth::restartMonoVoice(int note, int velocity)
+void Synth::restartMonoVoice(int p, int note, int velocity)
 {
-    float period = calcPeriod(0, note);
+    Part &part = parts[p];
+    Voice &voice = voices[part.monoVoice];
+
+    float period = calcPeriod(part, part.monoVoice, note);
 
-    Voice &voice = voices[0];
     voice.target = period;
 
-    if (glideMode == 0)
+    if (part.glideMode == 0)
+    {
         voice.period = period;
+        snapModulation(part.monoVoice);
+    }
 
     voice.cutoff = sampleRate / (period * PI);
 
     if (velocity > 0)
-        voice.cutoff *= std::exp(velocitySensitivity * float(velocity - 64));
+        voice.cutoff *= std::exp(part.velocitySensitivity * float(velocity - 64));
 
     voice.env.level += SILENCE + SILENCE;
     voice.note = note;
     voice.updatePanning();
 }
 
-void Synth::shiftQueuedNotes()
-{
-    for (int tmp = MAX_VOICES - 1; tmp > 0; tmp--)
-    {
-        voices[tmp].note = voices[tmp - 1].note;
-        voices[tmp].release();
-    }
-}
-
-int Synth::nextQueuedNote()
+void Synth::compileModulation()
 {
-    int held = 0;
+    std::array<const ModRoutes *, MAX_PARTS> partRoutes;
+    std::array<int, MAX_VOICES> lanePart;
 
-    for (int v = MAX_VOICES - 1; v > 0; v--)
+    for (int p = 0; p < numParts; ++p)
     {
-        if (voices[v].note > 0)
+        Part &part = parts[p];
+        ModRoutes &routes = part.modRoutes;
+
+        // These reproduce the fixed JX11 routings
+        routes.clear();
+        routes.add(ModSource::lfo1, ModSource::none, ModDestination::osc1Period, part.vibrato);
+        routes.add(ModSource::lfo1, ModSource::modWheel, ModDestination::osc1Period, 1.0f);
+        routes.add(ModSource::lfo1, ModSource::none, ModDestination::osc2Period, part.pwmDepth);
+        routes.add(ModSource::lfo1, ModSource::modWheel, ModDestination::osc2Period, 1.0f);
+        routes.add(ModSource::none, ModSource::none, ModDestination::cutoffSmoothed,
+                   part.filterKeytracking);
+        routes.add(ModSource::filterCtl, ModSource::none, ModDestination::cutoffSmoothed, 1.0f);
+        routes.add(ModSource::lfo1, ModSource::none, ModDestination::cutoffSmoothed,
+                   part.filterLFODepth);
+        routes.add(ModSource::lfo1, ModSource::pressure, ModDestination::cutoffSmoothed, 1.0f);
+        routes.add(ModSource::lfo2, ModSource::none, ModDestination::cutoff, part.lfo2Depth);
+
+        if (mpeEnabled)
         {
-            held = v;
+            // Same range as the filter CC in non-MPE mode
+            routes.add(ModSource::timbre, ModSource::none, ModDestination::cutoff, 2.54f);
+            routes.add(ModSource::notePressure, ModSource::none, ModDestination::cutoff, 1.5f);
         }
+
+        partRoutes[p] = &routes;
     }
 
-    if (held > 0)
+    for (int v = 0; v < MAX_VOICES; ++v)
     {
-        int note = voices[held].note;
-
-        voices[held].note = 0;
-
-        return note;
+        lanePart[v] = voices[v].part;
     }
 
-    return 0;
+    modMatrix.compile(partRoutes.data(), numParts, lanePart.data());
 }
 
 void Synth::updateLFO()
 {
     if (--lfoStep <= 0)
     {
-        lfoStep = LFO_MAX;
+        JX11_PROBE(updateLFO);
+        lfoStep = lfoMax;
 
-        lfo += lfoInc;
+        const LFOTable &table = *lfoTable;
 
-        if (lfo > PI)
-            lfo -= TAU;
+        std::array<float, MAX_PARTS> partLFO;
+        for (int p = 0; p < numParts; ++p)
+        {
+            Part &part = parts[p];
+            partLFO[p] = part.lfo.nextValue(part.lfoInc, part.lfoShape, table);
+        }
 
-        const float sine = std::sin(lfo);
+        float *lfo1 = modMatrix.source(ModSource::lfo1);
+        float *modWheel = modMatrix.source(ModSource::modWheel);
+        float *pressure = modMatrix.source(ModSource::pressure);
+        float *filterCtl = modMatrix.source(ModSource::filterCtl);
+        float *lfo2 = modMatrix.source(ModSource::lfo2);
+        float *notePressure = modMatrix.source(ModSource::notePressure);
+        float *timbre = modMatrix.source(ModSource::timbre);
 
-        float vibratoMod = 1.0f + sine * (modWheel + vibrato);
-        float pwm = 1.0f + sine * (modWheel + pwmDepth);
+        for (int v = 0; v < poolSize; ++v)
+        {
+            Voice &voice = voices[v];
+            const Part &part = parts[voice.part];
 
-        float filterMod = filterKeytracking + filterCtl + (filterLFODepth + pressure) * sine;
+            lfo1[v] = partLFO[voice.part];
+            modWheel[v] = part.modWheel;
+            pressure[v] = part.pressure;
+            filterCtl[v] = part.filterCtl;
 
-        filterZip += 0.005f * (filterMod - filterZip);
+            // Idle lanes keep running on the part's sources so that their
+            // smoothed cutoff is already settled when a voice starts there.
+            if (voice.env.isActive())
+            {
+                lfo2[v] = voice.lfo.nextValue(part.lfo2Inc, part.lfo2Shape, table);
+                notePressure[v] = voice.expression.pressure;
+                timbre[v] = voice.expression.timbre;
+            }
+            else
+            {
+                lfo2[v] = 0.0f;
+                notePressure[v] = 0.0f;
+                timbre[v] = 0.0f;
+            }
+        }
 
-        for (int v = 0; v < MAX_VOICES; ++v)
+        modMatrix.process(poolSize);
+
+        const float *osc1Mod = modMatrix.destination(ModDestination::osc1Period);
+        const float *osc2Mod = modMatrix.destination(ModDestination::osc2Period);
+        const float *cutoffMod = modMatrix.destination(ModDestination::cutoff);
+        const float *cutoffSmoothed = modMatrix.destination(ModDestination::cutoffSmoothed);
+
+        for (int v = 0; v < poolSize; ++v)
+        {
+            filterZip[v] += 0.005f * (cutoffSmoothed[v] - filterZip[v]);
+        }
+
+        const float inverseLfoMax = 1.0f / float(lfoMax);
+
+        for (int v = 0; v < poolSize; ++v)
         {
             Voice &voice = voices[v];
 
             if (voice.env.isActive())
             {
-                voice.osc1.modulation = vibratoMod;
-                voice.osc2.modulation = pwm;
-                voice.filterMod = filterZip;
+                for (int i = 0; i < voice.numUnison; ++i)
+                {
+                    voice.unison[i].osc1.modulation = 1.0f + osc1Mod[v];
+                    voice.unison[i].osc2.modulation = 1.0f + osc2Mod[v];
+                }
+                voice.filterMod = filterZip[v] + cutoffMod[v];
                 voice.updateLFO();
                 updatePeriod(voice);
+
+                if (audioRateActive)
+                {
+                    float cutoffTarget = std::log2(voice.modulatedCutoff);
+                    float periodTarget = std::log2(voice.period * voice.pitchBend);
+                    logCutoffStep[v] = (cutoffTarget - logCutoff[v]) * inverseLfoMax;
+                    logPeriodStep[v] = (periodTarget - logPeriod[v]) * inverseLfoMax;
+                }
+            }
+            else
+            {
+                logCutoffStep[v] = 0.0f;
+                logPeriodStep[v] = 0.0f;
             }
         }
     }
 }
 
-bool Synth::isPlayingLegatoStyle() const
+void Synth::updateModulation()
+{
+    JX11_PROBE(updateLFO);
+
+    // All lanes in the pool, including idle voices, so that the loop has no
+    // branches. The pool is a multiple of 8 lanes.
+    for (int v = 0; v < poolSize; ++v)
+    {
+        logCutoff[v] += logCutoffStep[v];
+        logPeriod[v] += logPeriodStep[v];
+        cutoffTransform[v] = fastExp(cutoffScale * fastExp2(logCutoff[v]));
+        voicePeriod[v] = fastExp2(logPeriod[v]);
+    }
+}
+
+void Synth::snapModulation(int v)
+{
+    // A new note starts at its own pitch instead of gliding in from the
+    // previous one over a control-rate update
+    const Voice &voice = voices[v];
+    float pitchBend = parts[voice.part].pitchBend * voice.expression.pitchBend;
+    logPeriod[v] = std::log2(voice.period * pitchBend);
+    logPeriodStep[v] = 0.0f;
+    logCutoff[v] = std::log2(voice.modulatedCutoff);
+    logCutoffStep[v] = 0.0f;
+}
+
+bool Synth::isPlayingLegatoStyle(int p) const
 {
     int held = 0;
-    for (int i = 0; i < MAX_VOICES; ++i)
+    for (int i = 0; i < poolSize; ++i)
     {
-        if (voices[i].note > 0)
+        if (voices[i].part == p && (voices[i].hold & Voice::KEY_DOWN))
             held += 1;
     }
 
+    // Keys held behind the note that the mono voice is playing
+    if (parts[p].numVoices == 1 && parts[p].keys.held.size() > 1)
+        held += parts[p].keys.held.size() - 1;
+
     return held > 0;
 }
@@ -12,84 +12,180 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "Voice.h"
+#include "Part.h"
+#include "LFO.h"
+#include "ModMatrix.h"
 #include "NoiseGenerator.h"
+#include "Utils.h"
+#include "SharedTables.h"
 
 class Synth
 {
   public:
     Synth();
 
-    bool ignoreVelocity;
-
-    float noiseMix;
-    float envAttack;
-    float envDecay;
-    float envSustain;
-    float envRelease;
-    float detune;
-    float oscMix;
-    float tune;
-    float volumeTrim;
-    float velocitySensitivity;
-    float lfoInc;
-    float vibrato;
-    float pwmDepth;
-    float glideRate;
-    float glideBend;
-    float filterKeytracking;
-    float filterQ;
-    float filterLFODepth;
-    float filterAttack, filterDecay, filterSustain, filterRelease;
-    float filterEnvDepth;
-
-    juce::LinearSmoothedValue<float> outputLevelSmoother;
-
-    int numVoices;
-    int glideMode;
-
-    static constexpr int MAX_VOICES = 8;
-    const int LFO_MAX = 32;
-
-    float calcPeriod(int v, int note) const;
+    static constexpr int MAX_VOICES = 16;
+    static constexpr int MAX_POLYPHONY = 8; // per part
+    static constexpr int MAX_PARTS = 16;
+    static constexpr int DEFAULT_LFO_MAX = 32;
+    static constexpr int MIN_LFO_MAX = 1;
+    static constexpr int MAX_LFO_MAX = 256;
+    static constexpr int MPE_MASTER_CHANNEL = 0;
+    static constexpr float MPE_BEND_RANGE = 48.0f; // semitones
+
+    std::array<Part, MAX_PARTS> parts;
+
+    // Output bus of each part, see render()
+    std::array<int, MAX_PARTS> partBus{};
+    int numBuses = 1;
+
+    // MPE lower zone: channel 1 is the master channel, every other channel
+    // carries the pitch bend, pressure and CC74 of a single note. All
+    // channels play the first part.
+    bool mpeEnabled;
+
+    // Number of samples between control-rate updates (LFOs, filter envelope,
+    // glide). Lower is smoother but more expensive.
+    int lfoMax = DEFAULT_LFO_MAX;
+
+    // Glides cutoff and pitch on every sample from one control-rate update
+    // to the next, instead of stepping them every lfoMax samples. Lags the
+    // modulation by one update.
+    bool audioRateModulation = false;
+
+    // Used by notes that start after it is changed
+    OscillatorMode oscillatorMode = OscillatorMode::blit;
+
+    float calcPeriod(const Part &part, int v, int note) const;
     void allocateResources(double sampleRate, int samplesPerBlock);
     void deallocateResources();
     void reset();
+
+    // outputBuffers holds a left/right pair for each of the numBuses output
+    // buses. The right channel may be nullptr for mono output.
     void render(float **outputBuffers, int sampleCount);
     void midiMesage(uint8_t data0, uint8_t data1, uint8_t data2);
 
+    // True for messages that only change values read by the control-rate
+    // update, so they don't need to split the render at their exact time
+    static bool isControlRateEvent(uint8_t data0, uint8_t data1)
+    {
+        switch (data0 & 0xF0)
+        {
+        case 0xD0:
+            return true;
+        case 0xB0:
+            return data1 == 0x01 || data1 == 0x4A || data1 == 0x4B;
+        default:
+            return false;
+        }
+    }
+
+    // How many samples must be rendered before a control-rate event that is
+    // `distance` samples ahead is applied, so that every control-rate update
+    // sees the same values as when the event is applied at its exact time.
+    // Zero when there is no update in between.
+    int samplesBeforeControlEvent(int distance) const
+    {
+        int nextUpdate = std::max(lfoStep, 1) - 1;
+        if (nextUpdate >= distance)
+            return 0;
+
+        return nextUpdate + ((distance - 1 - nextUpdate) / lfoMax) * lfoMax + 1;
+    }
+
+    // Rebuilds the modulation routes from the current parameter values
+    void compileModulation();
+
+    // With more than one part, MIDI channel N plays part N and channels
+    // without a part are ignored. A single part plays on all channels.
+    void setNumParts(int numParts);
+    int getNumParts() const { return numParts; }
+
+    // Envelope level of every voice (0 if idle), returns the number of
+    // active voices
+    int getVoiceLevels(std::array<float, MAX_VOICES> &levels) const;
+
+    // Number of voices the part plays, including released notes that are
+    // still sounding
+    int getNumActiveVoices(int p) const;
+
+    // Filled in by protectYourEars at the end of every render
+    ProtectionStats protectionStats;
+
   private:
-    bool sustainPedalPressed;
+    int numParts = 1;
+
+    // Size of the voice pool the active parts can use, the other voices
+    // stay idle and are skipped by the render loop
+    int poolSize = MAX_POLYPHONY;
 
-    int lastNote;
     int lfoStep;
 
     float sampleRate;
-    float pitchBend;
-    float lfo;
-    float modWheel;
-    float pressure;
-    float filterCtl;
-    float filterZip;
 
-    std::array<Voice, MAX_VOICES> voices;
-    NoiseGenerator noiseGen;
+    std::array<float, MAX_VOICES> filterZip;
 
-    bool isPlayingLegatoStyle() const;
+    // Audio-rate modulation, interpolated in the log2 domain so that a
+    // straight line is an exponential glide like the rest of the synth
+    bool audioRateActive = false;
+    float cutoffScale;
+    alignas(16) std::array<float, MAX_VOICES> logCutoff, logCutoffStep;
+    alignas(16) std::array<float, MAX_VOICES> logPeriod, logPeriodStep;
+    alignas(16) std::array<float, MAX_VOICES> cutoffTransform, voicePeriod;
 
-    int findFreeVoice() const;
-    int nextQueuedNote();
+    // Voice that last started on each MIDI channel, -1 if none
+    std::array<int, 16> channelVoice;
 
-    void startVoice(int v, int note, int velocity);
-    void restartMonoVoice(int note, int velocity);
-    void controlChange(uint8_t data1, uint8_t data2);
-    void noteOn(int note, int velocity);
-    void noteOff(int note);
-    void shiftQueuedNotes();
+    // MPE controllers may send a channel's expression before its note-on
+    std::array<NoteExpression, 16> channelExpression;
+
+    std::array<Voice, MAX_VOICES> voices;
+    NoiseGenerator noiseGen;
+    std::shared_ptr<const LFOTable> lfoTable; // shared by all instances
+    std::shared_ptr<const SawTables> sawTables;
+    std::shared_ptr<const SaturationTable> saturationTable;
+    ModMatrix<MAX_VOICES> modMatrix;
+
+    bool isPlayingLegatoStyle(int p) const;
+
+    int findFreeVoice(int p) const;
+    int findSustainedVoice(int p, int note) const;
+    int partForChannel(int channel) const;
+
+    void startVoice(int v, int p, int note, int velocity);
+    void restartMonoVoice(int p, int note, int velocity);
+    void controlChange(int p, uint8_t data1, uint8_t data2);
+    void sustainPedal(int p, bool pressed);
+    void sostenutoPedal(int p, bool pressed);
+    void releaseHeldVoices(int p, uint8_t flag);
+    void noteExpression(int channel, uint8_t data0, uint8_t data1, uint8_t data2);
+    void noteOn(int channel, int note, int velocity);
+    void noteOff(int channel, int note);
+    void assignChannel(int v, int channel);
     void updateLFO();
+    void updateModulation();
+    void snapModulation(int v);
 
     inline void updatePeriod(Voice &voice)
     {
-        voice.osc1.period = voice.period * pitchBend;
-        voice.osc2.period = voice.osc1.period * detune;
+        const Part &part = parts[voice.part];
+        voice.pitchBend = part.pitchBend * voice.expression.pitchBend;
+
+        setOscillatorPeriods(voice, voice.period * voice.pitchBend);
+    }
+
+    inline void setOscillatorPeriods(Voice &voice, float period)
+    {
+        const Part &part = parts[voice.part];
+        for (int i = 0; i < voice.numUnison; ++i)
+        {
+            UnisonVoice &u = voice.unison[i];
+            u.osc1.period = period * part.unisonDetune[i];
+            u.osc2.period = u.osc1.period * part.detune;
+        }
+
+        if (voice.tableOscillators)
+            voice.updateTableLanes();
     }
 };
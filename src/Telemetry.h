@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    Telemetry.h
+    Created: 19 Oct 2026 6:20:44pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "Synth.h"
+
+// What the engine was doing during one window of output
+struct TelemetryFrame
+{
+    static constexpr int SCOPE_SIZE = 128;
+    static constexpr int DECIMATION = 8; // samples per scope point
+
+    std::array<float, SCOPE_SIZE> scope;
+    float peak;
+    float rms;
+    int activeVoices;
+    std::array<float, Synth::MAX_VOICES> envelope;
+};
+
+/*
+ Wait-free single producer, single consumer queue of frames from the audio
+ thread to the editor. All frames are preallocated, the audio thread only
+ copies into a free slot and drops the frame when the editor falls behind.
+ */
+class TelemetryFifo
+{
+  public:
+    static constexpr int CAPACITY = 32;
+
+    bool push(const TelemetryFrame &frame)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0)
+            return false;
+
+        frames[start1] = frame;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    bool pop(TelemetryFrame &frame)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 == 0)
+            return false;
+
+        frame = frames[start1];
+        fifo.finishedRead(1);
+        return true;
+    }
+
+    // Only safe when neither side is using the queue
+    void reset() { fifo.reset(); }
+
+    // Drops all queued frames, called by the consumer
+    void clear() { fifo.finishedRead(fifo.getNumReady()); }
+
+  private:
+    juce::AbstractFifo fifo{CAPACITY};
+    std::array<TelemetryFrame, CAPACITY> frames;
+};
+
+/*
+ Collects the frames on the audio thread. Points are added one block at a
+ time and a frame is sent whenever the scope is full, so the rate of frames
+ doesn't depend on the block size.
+ */
+class TelemetryCollector
+{
+  public:
+    void reset()
+    {
+        numPoints = 0;
+        sampleCount = 0;
+        peak = 0.0f;
+        sumOfSquares = 0.0f;
+    }
+
+    void process(const float *left, const float *right, int numSamples, const Synth &synth,
+                 TelemetryFifo &fifo)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float x = (right != nullptr) ? 0.5f * (left[i] + right[i]) : left[i];
+
+            peak = std::max(peak, std::abs(x));
+            sumOfSquares += x * x;
+
+            if (++sampleCount % TelemetryFrame::DECIMATION == 0)
+            {
+                frame.scope[numPoints++] = x;
+
+                if (numPoints == TelemetryFrame::SCOPE_SIZE)
+                {
+                    frame.peak = peak;
+                    frame.rms = std::sqrt(sumOfSquares / float(sampleCount));
+                    frame.activeVoices = synth.getVoiceLevels(frame.envelope);
+                    fifo.push(frame);
+                    reset();
+                }
+            }
+        }
+    }
+
+  private:
+    TelemetryFrame frame;
+    int numPoints = 0;
+    int sampleCount = 0;
+    float peak = 0.0f;
+    float sumOfSquares = 0.0f;
+};
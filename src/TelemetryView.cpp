@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    TelemetryView.cpp
+    Created: 19 Oct 2026 6:41:17pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#include "TelemetryView.h"
+
+static constexpr int meterWidth = 12;
+static constexpr int voicesHeight = 40;
+static constexpr int textHeight = 15;
+
+//==============================================================================
+TelemetryView::TelemetryView()
+{
+    scopePath.preallocateSpace(3 * int(scope.size()) + 3);
+    setOpaque(true);
+}
+
+TelemetryView::~TelemetryView() {}
+
+void TelemetryView::addFrame(const TelemetryFrame &frame)
+{
+    std::copy(scope.begin() + TelemetryFrame::SCOPE_SIZE, scope.end(), scope.begin());
+    std::copy(frame.scope.begin(), frame.scope.end(), scope.end() - TelemetryFrame::SCOPE_SIZE);
+
+    latest = frame;
+
+    // The peak indicator falls back slowly
+    peakHold = std::max(frame.peak, peakHold * 0.9f);
+}
+
+void TelemetryView::paint(juce::Graphics &g)
+{
+    g.fillAll(juce::Colours::black);
+
+    auto bounds = getLocalBounds();
+    auto meter = bounds.removeFromRight(meterWidth);
+    auto voices = bounds.removeFromBottom(voicesHeight);
+    auto text = voices.removeFromTop(textHeight);
+    auto scopeArea = bounds.reduced(2);
+
+    // Oscilloscope
+    float x = float(scopeArea.getX());
+    float dx = float(scopeArea.getWidth()) / float(scope.size() - 1);
+    float centre = float(scopeArea.getY()) + 0.5f * float(scopeArea.getHeight());
+    float halfHeight = 0.5f * float(scopeArea.getHeight());
+
+    scopePath.clear();
+    scopePath.startNewSubPath(x, centre - halfHeight * std::clamp(scope[0], -1.0f, 1.0f));
+    for (size_t i = 1; i < scope.size(); ++i)
+    {
+        x += dx;
+        scopePath.lineTo(x, centre - halfHeight * std::clamp(scope[i], -1.0f, 1.0f));
+    }
+    g.setColour(juce::Colours::green);
+    g.strokePath(scopePath, juce::PathStrokeType(1.0f));
+
+    // Level meter, RMS as a bar and the peak as a line
+    float meterHeight = float(meter.getHeight());
+    float rmsHeight = meterHeight * std::min(latest.rms, 1.0f);
+    float peakY = float(meter.getBottom()) - meterHeight * std::min(peakHold, 1.0f);
+    g.setColour(juce::Colours::darkgrey);
+    g.fillRect(meter);
+    g.setColour(latest.peak >= 1.0f ? juce::Colours::red : juce::Colours::green);
+    g.fillRect(float(meter.getX()), float(meter.getBottom()) - rmsHeight,
+               float(meter.getWidth()), rmsHeight);
+    g.setColour(juce::Colours::yellow);
+    g.drawHorizontalLine(int(peakY), float(meter.getX()), float(meter.getRight()));
+
+    // Voices, one bar per voice showing its envelope level
+    g.setColour(juce::Colours::white);
+    g.setFont(12.0f);
+    g.drawText("Voices: " + juce::String(latest.activeVoices), text,
+               juce::Justification::centredLeft);
+
+    float barWidth = float(voices.getWidth()) / float(Synth::MAX_VOICES);
+    float barHeight = float(voices.getHeight());
+    for (int v = 0; v < Synth::MAX_VOICES; ++v)
+    {
+        float level = barHeight * std::clamp(latest.envelope[v], 0.0f, 1.0f);
+        g.setColour(juce::Colours::orange);
+        g.fillRect(float(voices.getX()) + barWidth * float(v) + 1.0f,
+                   float(voices.getBottom()) - level, barWidth - 2.0f, level);
+    }
+}
+
+void TelemetryView::resized() {}
@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    TelemetryView.h
+    Created: 19 Oct 2026 6:41:17pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "Telemetry.h"
+
+//==============================================================================
+/*
+ Oscilloscope, level meter and voice display. The editor hands it the frames
+ it has read from the processor's TelemetryFifo.
+ */
+class TelemetryView : public juce::Component
+{
+  public:
+    TelemetryView();
+    ~TelemetryView() override;
+
+    void addFrame(const TelemetryFrame &frame);
+
+    void paint(juce::Graphics &) override;
+    void resized() override;
+
+  private:
+    static constexpr int SCOPE_FRAMES = 2;
+
+    // The last few frames of scope points, oldest first
+    std::array<float, SCOPE_FRAMES * TelemetryFrame::SCOPE_SIZE> scope{};
+
+    TelemetryFrame latest{};
+    float peakHold = 0.0f;
+
+    juce::Path scopePath;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TelemetryView)
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+    Created: 20 Oct 2026 1:52:06pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+
+static const char *eventNames[] = {
+    "processBlock", "MIDI", "render", "update", "setCurrentProgram", "setStateInformation",
+};
+
+static const char *argNames[] = {
+    "samples", "status", "samples", "", "program", "bytes",
+};
+
+TraceRecorder::TraceRecorder() : juce::Thread("JX11 trace writer") {}
+
+TraceRecorder::~TraceRecorder() { stop(); }
+
+bool TraceRecorder::start(const juce::File &file)
+{
+    stop();
+
+    file.deleteFile();
+    stream = file.createOutputStream();
+    if (stream == nullptr)
+        return false;
+
+    if (rings == nullptr)
+        rings = std::make_unique<std::array<Ring, NUM_PRODUCERS>>();
+
+    *stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    // Anything left in the rings from an earlier recording is older than
+    // this and gets skipped
+    startTicks = juce::Time::getHighResolutionTicks();
+    firstEvent = true;
+    dropped.store(0);
+
+    recording.store(true, std::memory_order_release);
+    startThread();
+    return true;
+}
+
+void TraceRecorder::stop()
+{
+    if (stream == nullptr)
+        return;
+
+    recording.store(false);
+    stopThread(2000);
+
+    *stream << "\n],\"otherData\":{\"droppedEvents\":" << int(dropped.load()) << "}}\n";
+    stream->flush();
+    stream.reset();
+}
+
+void TraceRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        drain();
+        wait(20);
+    }
+    drain();
+}
+
+void TraceRecorder::drain()
+{
+    for (Ring &ring : *rings)
+    {
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToRead(ring.fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            writeEvent(ring.events[start1 + i]);
+
+        for (int i = 0; i < size2; ++i)
+            writeEvent(ring.events[start2 + i]);
+
+        ring.fifo.finishedRead(size1 + size2);
+    }
+}
+
+void TraceRecorder::writeEvent(const TraceEvent &event)
+{
+    if (event.start < startTicks)
+        return;
+
+    const double ticksPerMicrosecond =
+        double(juce::Time::getHighResolutionTicksPerSecond()) / 1000000.0;
+
+    juce::String json = firstEvent ? "" : ",\n";
+    firstEvent = false;
+
+    json += "{\"name\":\"" + juce::String(eventNames[event.type]) + "\",\"pid\":1,\"tid\":" +
+            juce::String(int(event.thread) + 1) + ",\"ts\":" +
+            juce::String(double(event.start - startTicks) / ticksPerMicrosecond, 3);
+
+    if (event.duration >= 0)
+    {
+        json += ",\"ph\":\"X\",\"dur\":" +
+                juce::String(double(event.duration) / ticksPerMicrosecond, 3);
+    }
+    else
+    {
+        json += ",\"ph\":\"i\",\"s\":\"t\"";
+    }
+
+    if (argNames[event.type][0] != '\0')
+    {
+        json += ",\"args\":{\"" + juce::String(argNames[event.type]) +
+                "\":" + juce::String(event.arg) + "}";
+    }
+
+    *stream << json << "}";
+}
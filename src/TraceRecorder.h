@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+    Created: 20 Oct 2026 1:52:06pm
+    Author:  Jaco Stroebel
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+struct TraceEvent
+{
+    enum Type : uint8_t
+    {
+        processBlock,
+        midiEvent,
+        render,
+        update,
+        programChange,
+        stateLoad,
+    };
+
+    Type type;
+    uint8_t thread; // index of the ring it was recorded into
+    juce::int64 start;
+    juce::int64 duration; // in ticks, -1 for an instant event
+    int arg;
+};
+
+/*
+ Records what the audio thread is doing into a preallocated ring and writes
+ it out in the Chrome trace event format (chrome://tracing, Perfetto) from a
+ background thread. Nothing is recorded until start() is called, and then an
+ event costs one copy into the ring. Events are dropped if the writer can't
+ keep up.
+
+ Each recording thread gets its own single producer ring: one for the audio
+ thread and one for the message thread, which can change programs too.
+ Events from any other thread are dropped. The rings are only allocated by
+ the first start(), an instance that never traces doesn't pay for them.
+ */
+class TraceRecorder : private juce::Thread
+{
+  public:
+    enum Producer
+    {
+        audioThread,
+        messageThread,
+        NUM_PRODUCERS,
+        unknownThread = NUM_PRODUCERS,
+    };
+
+    TraceRecorder();
+    ~TraceRecorder() override;
+
+    // Message thread. Returns false if the file couldn't be opened.
+    bool start(const juce::File &file);
+    void stop();
+
+    // Acquire, so that a thread that sees the recording also sees the rings
+    bool isRecording() const { return recording.load(std::memory_order_acquire); }
+
+    // Audio thread, at the start of every block
+    void setAudioThread()
+    {
+        audioThreadId.store(juce::Thread::getCurrentThreadId(), std::memory_order_relaxed);
+    }
+
+    // For code that can run on more than one thread. The caller knows if it
+    // is on the message thread, this class doesn't depend on juce_events.
+    Producer producerFor(bool isMessageThread) const
+    {
+        if (isMessageThread)
+            return messageThread;
+        if (juce::Thread::getCurrentThreadId() == audioThreadId.load(std::memory_order_relaxed))
+            return audioThread;
+        return unknownThread;
+    }
+
+    void record(Producer producer, TraceEvent::Type type, juce::int64 start,
+                juce::int64 duration, int arg)
+    {
+        if (!isRecording() || producer == unknownThread)
+            return;
+
+        Ring &ring = (*rings)[producer];
+
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 == 0)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ring.events[start1] = {type, uint8_t(producer), start, duration, arg};
+        ring.fifo.finishedWrite(1);
+    }
+
+    void instant(Producer producer, TraceEvent::Type type, int arg)
+    {
+        if (isRecording())
+            record(producer, type, juce::Time::getHighResolutionTicks(), -1, arg);
+    }
+
+  private:
+    static constexpr int RING_SIZE = 1 << 15;
+
+    struct Ring
+    {
+        juce::AbstractFifo fifo{RING_SIZE};
+        std::array<TraceEvent, RING_SIZE> events;
+    };
+
+    void run() override;
+    void drain();
+    void writeEvent(const TraceEvent &event);
+
+    // Kept until the recorder is destroyed, the audio thread may still be
+    // writing when a new recording starts
+    std::unique_ptr<std::array<Ring, NUM_PRODUCERS>> rings;
+    std::atomic<bool> recording{false};
+    std::atomic<juce::Thread::ThreadID> audioThreadId{};
+    std::atomic<uint32_t> dropped{0};
+
+    // Owned by the writer thread while recording
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::int64 startTicks = 0;
+    bool firstEvent = true;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TraceRecorder)
+};
+
+// Records the time between construction and destruction as one event
+class ScopedTrace
+{
+  public:
+    ScopedTrace(TraceRecorder &recorder_, TraceRecorder::Producer producer_,
+                TraceEvent::Type type_, int arg_)
+        : recorder(recorder_.isRecording() && producer_ != TraceRecorder::unknownThread
+                       ? &recorder_
+                       : nullptr),
+          producer(producer_),
+          type(type_), arg(arg_)
+    {
+        if (recorder != nullptr)
+            start = juce::Time::getHighResolutionTicks();
+    }
+
+    ~ScopedTrace()
+    {
+        if (recorder != nullptr)
+            recorder->record(producer, type, start,
+                             juce::Time::getHighResolutionTicks() - start, arg);
+    }
+
+  private:
+    TraceRecorder *recorder;
+    TraceRecorder::Producer producer;
+    TraceEvent::Type type;
+    int arg;
+    juce::int64 start = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(ScopedTrace)
+};
@@ -10,8 +10,56 @@
 
 #pragma once
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <bit>
 
-inline void protectYourEars(float *buffer, int sampleCount)
+// 32-bit FNV-1a hash of a string, stops at a terminator or after maxLength
+// bytes. Used to identify parameters and presets in files.
+inline uint32_t hashString(const char *text, size_t maxLength = SIZE_MAX)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < maxLength && text[i] != 0; ++i)
+    {
+        hash = (hash ^ uint8_t(text[i])) * 16777619u;
+    }
+    return hash;
+}
+
+// 2^x to within 4e-6 relative error, for per-sample modulation where
+// std::exp would be too slow. Has no branches so that loops over the voices
+// can be vectorized.
+inline float fastExp2(float x)
+{
+    x = std::clamp(x, -126.0f, 126.0f);
+
+    // Split into a whole power of two and a fraction in [-0.5, 0.5]
+    int whole = int(x + 127.5f) - 127;
+    float f = x - float(whole);
+
+    // Taylor series of e^(f ln 2)
+    float p = 1.0f + f * (0.69314718f + f * (0.24022651f + f * (0.05550411f +
+                     f * (0.00961813f + f * 0.00133336f))));
+
+    return p * std::bit_cast<float>((whole + 127) << 23);
+}
+
+inline float fastExp(float x) { return fastExp2(x * 1.44269504f); }
+
+// How often protectYourEars had to step in, counted once per buffer
+struct ProtectionStats
+{
+    std::atomic<uint32_t> nan{0};
+    std::atomic<uint32_t> inf{0};
+    std::atomic<uint32_t> outOfRange{0};
+    std::atomic<uint32_t> clamped{0};
+
+    // Only the audio thread writes
+    static void increment(std::atomic<uint32_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+inline void protectYourEars(float *buffer, int sampleCount, ProtectionStats *stats = nullptr)
 {
     if (buffer == nullptr)
     {
@@ -19,6 +67,7 @@ inline void protectYourEars(float *buffer, int sampleCount)
     }
 
     bool firstWarning = true;
+    bool firstOutOfRange = true;
 
     for (int i = 0; i < sampleCount; ++i)
     {
@@ -30,16 +79,23 @@ inline void protectYourEars(float *buffer, int sampleCount)
         {
             DBG("WARNING: nan detected in audio buffer, silencing !!!");
             silence = true;
+            if (stats != nullptr)
+                ProtectionStats::increment(stats->nan);
             jassert(!silence);
         }
         else if (std::isinf(x))
         {
             DBG("WARNING: inf detected in audio buffer, silencing !!!");
             silence = true;
+            if (stats != nullptr)
+                ProtectionStats::increment(stats->inf);
         }
         else if (x < -2.0f || x > 2.0f)
         {
             DBG("WARNING: sample out of range, silencing !!!");
+            if (stats != nullptr && firstOutOfRange)
+                ProtectionStats::increment(stats->outOfRange);
+            firstOutOfRange = false;
         }
         else if (x < -1.0f)
         {
@@ -47,6 +103,8 @@ inline void protectYourEars(float *buffer, int sampleCount)
             {
                 DBG("WARNING: sample out of range, clamping !!!");
                 firstWarning = false;
+                if (stats != nullptr)
+                    ProtectionStats::increment(stats->clamped);
             }
             buffer[i] = -1.0f;
         }
@@ -56,6 +114,8 @@ inline void protectYourEars(float *buffer, int sampleCount)
             {
                 DBG("WARNING: sample out of range, clamping !!!");
                 firstWarning = false;
+                if (stats != nullptr)
+                    ProtectionStats::increment(stats->clamped);
             }
             buffer[i] = 1.0f;
         }
@@ -72,6 +132,8 @@ template <typename T>
 inline static void castParameter(juce::AudioProcessorValueTreeState &aptvs,
                                  const juce::ParameterID &id, T &destination)
 {
-    destination = dynamic_cast<T>(aptvs.getParameter(id.getParamID()));
-    jassert(destination); // parameter does not exist or wrong type
+    // The type only needs checking once, in debug builds
+    juce::RangedAudioParameter *parameter = aptvs.getParameter(id.getParamID());
+    jassert(dynamic_cast<T>(parameter) != nullptr); // parameter does not exist or wrong type
+    destination = static_cast<T>(parameter);
 }
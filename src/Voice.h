@@ -11,16 +11,82 @@
 #pragma once
 
 #include "Oscillator.h"
+#include "SawTables.h"
 #include "Envelope.h"
 #include "Filter.h"
+#include "LFO.h"
+#include "Profiler.h"
 
-struct Voice
+// Per-note MPE expression, picked up at the next control-rate update
+struct NoteExpression
 {
+    float pitchBend = 1.0f;
+    float pressure = 0.0f;
+    float timbre = 0.0f;
+};
+
+// One copy of the oscillator pair in a unison stack
+struct UnisonVoice
+{
+    Oscillator osc1;
+    Oscillator osc2;
+};
+
+/*
+ The members are ordered by how often they are used: first the state that
+ render() reads on every sample, then the per-note data that only the
+ control-rate update and a new note read.
+ */
+struct alignas(64) Voice
+{
+    static constexpr int MAX_UNISON = 8;
+    static constexpr int NUM_TABLE_LANES = 2 * MAX_UNISON;
+
+    // Flags in hold, a voice is released once none of them are set
+    static constexpr uint8_t KEY_DOWN = 1;
+    static constexpr uint8_t SUSTAINED = 2; // by the sustain pedal
+    static constexpr uint8_t SOSTENUTO = 4; // by the sostenuto pedal
+
+    Envelope env;
+    Filter filter;
+    float panLeft, panRight;
+
+    // Unison stacks numUnison copies of the oscillator pair on one note. The
+    // copies share the envelopes and the filter, or a left/right pair of
+    // filters when they are spread across the stereo field.
+    int numUnison;
+    bool stereoFilter;
+    bool tableOscillators; // OscillatorMode::table, chosen when a note starts
+    const SawTables *sawTables = nullptr;
+
+    // Output of each copy, integrated in BLIT mode, and its stereo gains
+    alignas(16) std::array<float, MAX_UNISON> saw;
+    alignas(16) std::array<float, MAX_UNISON> gainLeft;
+    alignas(16) std::array<float, MAX_UNISON> gainRight;
+
+    /*
+     Table mode keeps its oscillators in lanes, one array per field, so that
+     the copies of the stack render side by side. Lane 2i is osc1 of copy i
+     and lane 2i + 1 its osc2, with a negative amplitude to subtract it. The
+     phase wraps around by integer overflow, so it never drifts and the pitch
+     is exactly the increment instead of a period rounded to a whole number
+     of samples.
+     */
+    alignas(16) std::array<uint32_t, NUM_TABLE_LANES> tablePhase;
+    alignas(16) std::array<uint32_t, NUM_TABLE_LANES> tableInc;
+    alignas(16) std::array<float, NUM_TABLE_LANES> tableAmplitude;
+    std::array<const float *, NUM_TABLE_LANES> table;
+
+    std::array<UnisonVoice, MAX_UNISON> unison;
+    Filter filterRight;
+
+    // Per-note data
     int note;
+    uint8_t hold;
+    int part;
+    int channel;
     int lastNote;
-    float saw;
     float period;
-    float panLeft, panRight;
     float target;
     float glideRate;
     float cutoff;
@@ -28,39 +94,212 @@ struct Voice
     float filterQ;
     float pitchBend;
     float filterEnvDepth;
+    float modulatedCutoff; // in Hz, as of the last control-rate update
+    float unisonSpread;
 
-    Oscillator osc1;
-    Oscillator osc2;
-    Filter filter;
+    NoteExpression expression;
 
-    Envelope env;
     Envelope filterEnv;
+    LFO lfo;
 
     void reset()
     {
         note = 0;
-        saw = 0.0f;
+        hold = 0;
+        part = 0;
+        channel = 0;
+        modulatedCutoff = 200.0f;
         panLeft = 0.707f;
         panRight = 0.707f;
-        osc1.reset();
-        osc2.reset();
+        numUnison = 1;
+        unisonSpread = 0.0f;
+        stereoFilter = false;
+        tableOscillators = false;
+        for (UnisonVoice &u : unison)
+        {
+            u.osc1.reset();
+            u.osc2.reset();
+        }
+        saw.fill(0.0f);
+        gainLeft.fill(0.707f);
+        gainRight.fill(0.707f);
+        tablePhase.fill(0);
+        tableInc.fill(0);
+        tableAmplitude.fill(0.0f);
+        table.fill(nullptr);
         env.reset();
         filter.reset();
+        filterRight.reset();
         filterEnv.reset();
+        lfo.reset();
+        expression = {};
     }
 
-    float render(float input)
+    // A cutoffTransform above zero replaces the smoothed cutoff for this
+    // sample, see Filter::render()
+    void render(float input, float &left, float &right, float cutoffTransform = 0.0f)
     {
-        float sample1 = osc1.nextSample();
-        float sample2 = osc2.nextSample();
-        saw = saw * 0.997f + sample1 - sample2;
+        {
+            JX11_PROBE(oscillators);
+            if (tableOscillators)
+                renderTableLanes();
+            else
+                renderBlit();
+        }
+
+        if (!stereoFilter)
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < numUnison; ++i)
+            {
+                sum += saw[i];
+            }
+
+            float output = sum + input;
+            {
+                JX11_PROBE(filter);
+                output = (cutoffTransform > 0.0f) ? filter.render(output, cutoffTransform)
+                                                  : filter.render(output);
+            }
+
+            float envelope;
+            {
+                JX11_PROBE(envelope);
+                envelope = env.nextValue();
+            }
 
-        float output = saw + input;
-        output = filter.render(output);
+            output *= envelope;
+            left = output * panLeft;
+            right = output * panRight;
+        }
+        else
+        {
+            float sumLeft = 0.0f;
+            float sumRight = 0.0f;
+            for (int i = 0; i < numUnison; ++i)
+            {
+                sumLeft += saw[i] * gainLeft[i];
+                sumRight += saw[i] * gainRight[i];
+            }
 
-        float envelope = env.nextValue();
+            float envelope;
+            {
+                JX11_PROBE(envelope);
+                envelope = env.nextValue();
+            }
 
-        return output * envelope;
+            JX11_PROBE(filter);
+            if (cutoffTransform > 0.0f)
+            {
+                left = filter.render(sumLeft + input, cutoffTransform) * envelope;
+                right = filterRight.render(sumRight + input, cutoffTransform) * envelope;
+            }
+            else
+            {
+                left = filter.render(sumLeft + input) * envelope;
+                right = filterRight.render(sumRight + input) * envelope;
+            }
+        }
+    }
+
+    // The BLIT oscillator branches on its phase every sample, so the copies
+    // render one after the other
+    inline void renderBlit()
+    {
+        for (int i = 0; i < numUnison; ++i)
+        {
+            float sample1 = unison[i].osc1.nextSample();
+            float sample2 = unison[i].osc2.nextSample();
+            saw[i] = saw[i] * 0.997f + sample1 - sample2;
+        }
+    }
+
+    /*
+     The phase step runs over all lanes at once, which the compiler turns
+     into vector instructions. It rounds up to a multiple of four lanes so
+     that there is no scalar remainder, the lanes past the stack are stepped
+     but never read. The table reads can't be vectorized, they happen one
+     lane at a time. The tables already hold the integrated waveform.
+     */
+    inline void renderTableLanes()
+    {
+        constexpr int FRACTION_BITS = 32 - SawTables::SIZE_BITS;
+        constexpr uint32_t FRACTION_MASK = (1u << FRACTION_BITS) - 1;
+        const int numLanes = 2 * numUnison;
+
+        alignas(16) std::array<uint32_t, NUM_TABLE_LANES> index;
+        alignas(16) std::array<float, NUM_TABLE_LANES> frac;
+        for (int lane = 0; lane < ((numLanes + 3) & ~3); ++lane)
+        {
+            index[lane] = tablePhase[lane] >> FRACTION_BITS;
+            frac[lane] = float(int32_t(tablePhase[lane] & FRACTION_MASK)) *
+                         (1.0f / float(1u << FRACTION_BITS));
+            tablePhase[lane] += tableInc[lane];
+        }
+
+        alignas(16) std::array<float, NUM_TABLE_LANES> value;
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const float *t = table[lane] + index[lane];
+            value[lane] = tableAmplitude[lane] * (t[0] + frac[lane] * (t[1] - t[0]));
+        }
+
+        for (int i = 0; i < numUnison; ++i)
+        {
+            saw[i] = value[2 * i] + value[2 * i + 1];
+        }
+    }
+
+    // Call after changing the period, modulation or amplitude of any of the
+    // oscillators in table mode
+    void updateTableLanes()
+    {
+        for (int i = 0; i < numUnison; ++i)
+        {
+            setTableLane(2 * i, unison[i].osc1, 1.0f);
+            setTableLane(2 * i + 1, unison[i].osc2, -1.0f);
+        }
+    }
+
+    void setTableLane(int lane, const Oscillator &osc, float sign)
+    {
+        tableInc[lane] = osc.tableIncrement();
+        tableAmplitude[lane] = sign * osc.amplitude;
+        table[lane] = sawTables->forIncrement(tableInc[lane]);
+    }
+
+    // Turns copy i into a pulse wave, see Oscillator::squareWave()
+    void squareWave(int i, float newPeriod)
+    {
+        unison[i].osc2.squareWave(unison[i].osc1, newPeriod);
+
+        // Half a cycle apart, modulating the period of one of the pair
+        // moves the edge
+        tablePhase[2 * i + 1] = tablePhase[2 * i] + 0x80000000u;
+    }
+
+    // Takes effect on the next note, changing the stack size of a sounding
+    // note would restart its oscillators
+    void setUnison(int count, float spread)
+    {
+        for (int i = numUnison; i < count; ++i)
+        {
+            unison[i].osc1.reset();
+            unison[i].osc2.reset();
+            saw[i] = 0.0f;
+            tablePhase[2 * i] = 0;
+            tablePhase[2 * i + 1] = 0;
+        }
+
+        bool stereo = count > 1 && spread > 0.0f;
+        if (stereo && !stereoFilter)
+        {
+            filterRight.reset();
+        }
+
+        numUnison = count;
+        unisonSpread = spread;
+        stereoFilter = stereo;
     }
 
     void release()
@@ -74,6 +313,18 @@ struct Voice
         float panning = std::clamp((note - 60.0f) / 24.0f, -1.0f, 1.0f);
         panLeft = std::sin(PI_OVER_4 * (1.0f - panning));
         panRight = std::sin(PI_OVER_4 * (1.0f + panning));
+
+        if (stereoFilter)
+        {
+            // Spread the stack evenly around the note's position
+            for (int i = 0; i < numUnison; ++i)
+            {
+                float offset = 2.0f * float(i) / float(numUnison - 1) - 1.0f;
+                float pan = std::clamp(panning + unisonSpread * offset, -1.0f, 1.0f);
+                gainLeft[i] = std::sin(PI_OVER_4 * (1.0f - pan));
+                gainRight[i] = std::sin(PI_OVER_4 * (1.0f + pan));
+            }
+        }
     }
 
     void updateLFO()
@@ -82,9 +333,12 @@ struct Voice
 
         float fenv = filterEnv.nextValue();
 
-        float modulatedCutoff = cutoff * std::exp(filterMod + filterEnvDepth + fenv) / pitchBend;
+        modulatedCutoff = cutoff * std::exp(filterMod + filterEnvDepth + fenv) / pitchBend;
 
         modulatedCutoff = std::clamp(modulatedCutoff, 30.0f, 20000.0f);
         filter.updateCoefficients(modulatedCutoff, filterQ);
+
+        if (stereoFilter)
+            filterRight.updateCoefficients(modulatedCutoff, filterQ);
     }
 };